@@ -10,7 +10,7 @@
 #include "WireCellIface/IAnodePlane.h"
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellUtil/Logging.h"
-#include <unordered_map>
+#include <vector>
 
 namespace WireCell {
     namespace Gen {
@@ -37,15 +37,48 @@ namespace WireCell {
             virtual IChannel::pointer channel(int chident) const;
             virtual IWire::vector wires(int channel) const;
 
+            /// Not in the interface.  Each channel has a dense index
+            /// from 0 to nchannels()-1 in order of channel ident.
+            /// Per-channel loops may use it to index arrays instead
+            /// of looking up by ident.
+            size_t nchannels() const { return m_channels.size(); }
+
+            /// Return the index of the channel or -1 if the channel
+            /// is not in this anode.
+            int channel_index(int chident) const;
+
+            /// Arrays indexed by channel index.  These are the
+            /// channel ident, WirePlaneId::ident(), WirePlaneId::index()
+            /// and total length of all wire segments.
+            const std::vector<int>& channel_idents() const { return m_channels; }
+            const std::vector<int>& channel_wpids() const { return m_wpids; }
+            const std::vector<int>& channel_planes() const { return m_planes; }
+            const std::vector<double>& channel_wire_lengths() const { return m_wire_lengths; }
+
+            /// The wire segments and the channel at a channel index.
+            const IWire::vector& channel_wires(int index) const { return m_wires.at(index); }
+            const IChannel::pointer& channel_at(int index) const { return m_ichannels.at(index); }
+
         private:
 
             int m_ident;
             IAnodeFace::vector m_faces;
 
-            std::unordered_map<int, int> m_c2wpid;
-            std::unordered_map<int, IWire::vector> m_c2wires;
+            // Sorted channel idents, giving the channel index.
             std::vector<int> m_channels;
-            std::unordered_map<int, IChannel::pointer> m_ichannels;
+
+            // Indexed by channel index.
+            std::vector<int> m_wpids, m_planes;
+            std::vector<double> m_wire_lengths;
+            std::vector<IWire::vector> m_wires;
+            IChannel::vector m_ichannels;
+
+            // Maps channel ident minus m_chid_offset to channel
+            // index when idents are nearly contiguous, else empty and
+            // m_channels is searched.
+            int m_chid_offset;
+            std::vector<int> m_chid_table;
+
             Log::logptr_t l;
         };
     }
@@ -73,6 +73,23 @@ namespace WireCell {
 	    /// drastically different response.
 	    ImpactData::pointer impact_data(int bin) const;
 
+            /// Sample all held diffusions now, visiting impact bins
+            /// in increasing order.  This is the same order that
+            /// zipping through wires in increasing order visits them
+            /// so fluctuations are drawn from any IRandom in the
+            /// same sequence.  After this call no IRandom is used.
+            void sample_all();
+
+            /// Return a new BinnedDiffusion covering only the half
+            /// open impact index range and sharing the diffusions
+            /// associated with it.  The subset holds its own
+            /// ImpactData so it and this object may be read from
+            /// different threads as long as sample_all() was called
+            /// beforehand.  The subset refers to the same pimpos and
+            /// time binning as this object so must not outlive them.
+            std::shared_ptr<BinnedDiffusion> subset(int begin_impact_index,
+                                                    int end_impact_index) const;
+
 	    // test ... 
 	    //	    void get_charge_vec(std::vector<std::vector<std::tuple<int,int, double> > >& vec_vec_charge, std::vector<int>& vec_impact);
 
@@ -94,6 +111,11 @@ namespace WireCell {
             std::pair<int,int> time_bin_range(double nsigma=0.0) const;
 
 	    double get_nsigma() const {return m_nsigma;};
+
+            /// Number of depos rejected by add() for lying too far
+            /// outside the pitch or time domain.
+            int outside_pitch() const { return m_outside_pitch; }
+            int outside_time() const { return m_outside_time; }
 	    
 	private:
 	    
@@ -114,6 +136,9 @@ namespace WireCell {
 
             int m_outside_pitch;
             int m_outside_time;
+
+            // True once sample_all() has fixed all samplings.
+            bool m_sampled;
 	};
 
 
@@ -61,6 +61,12 @@ namespace WireCell {
 	    /// Return false if no activity falls within the domain.
 	    bool add(IDepo::pointer deposition, double sigma_time, double sigma_pitch);
 
+	    /// As above but the domain in pitch is only the impact
+	    /// bins [impacts.first, impacts.second).  The charge is
+	    /// sampled and kept as if the impact binning ended there.
+	    bool add(IDepo::pointer deposition, double sigma_time, double sigma_pitch,
+	             std::pair<int,int> impacts);
+
 	    /// Unconditionally associate an already built
 	    /// GaussianDiffusion to one impact.  
 	    //void add(std::shared_ptr<GaussianDiffusion> gd, int impact_index);
@@ -99,6 +105,11 @@ namespace WireCell {
             std::pair<int,int> time_bin_range(double nsigma=0.0) const;
 
 	    double get_nsigma() const {return m_nsigma;};
+
+            /// Number of depos rejected by add() for lying too far
+            /// outside the pitch or time domain.
+            int outside_pitch() const { return m_outside_pitch; }
+            int outside_time() const { return m_outside_time; }
 	    
 	private:
 	    
@@ -25,6 +25,9 @@ namespace WireCell {
             virtual void configure(const WireCell::Configuration& cfg);
             virtual WireCell::Configuration default_configuration() const;
 
+            /// Not in the interface.
+            IRandom::pointer rng() const { return m_rng; }
+
 	    // Internal base class for something that makes a scalar
 	    struct ScalarMaker {
 		virtual double operator()() = 0;
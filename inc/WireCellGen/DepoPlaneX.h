@@ -6,6 +6,7 @@
 #include "WireCellIface/IDepo.h"
 
 #include <deque>
+#include <vector>
 
 namespace WireCell {
     namespace Gen {
@@ -23,12 +24,17 @@ namespace WireCell {
 	 * must (causally) come later.  Any depos older than this time
 	 * are considered "frozen out" as nothing can change their
 	 * ordering.
+	 *
+	 * Thawed depos are kept in a binary min-heap on their time
+	 * at the plane so adding a depo and freezing out the ripe
+	 * ones cost O(log N) per depo.
 	 */
 
 	class DepoPlaneX {
 	public:
 	    typedef std::deque<IDepo::pointer> frozen_queue_t;
-	    typedef DepoTauSortedSet working_queue_t;
+	    /// The working queue is a heap and is not sorted.
+	    typedef std::vector<IDepo::pointer> working_queue_t;
 
 	    DepoPlaneX(double planex = 0.0*units::cm,
 		       double speed = 1.6*units::millimeter/units::microsecond);
@@ -62,11 +68,19 @@ namespace WireCell {
 
 	private:
 	    double m_planex, m_speed;
+	    IDepoDriftCompare m_compare;
 	    working_queue_t m_queue;
 	    frozen_queue_t m_frozen;
 
 	    /// Move all froze-out depos to the frozen queue
 	    void drain(double time);
+
+	    // Heap order, true if lhs comes after rhs.
+	    bool later(const IDepo::pointer& lhs, const IDepo::pointer& rhs) const {
+		return m_compare(rhs, lhs);
+	    }
+	    // Move the earliest depo from the heap to the frozen queue.
+	    void freeze_one();
 	};
 
 
@@ -0,0 +1,49 @@
+/** A DepoSetFanin merges N depo sets into one.
+
+    The depos of each input set are expected to be in time order (as
+    produced by a drifter and bagger).  They are k-way merged in bulk
+    with a min-heap so that the output set is in time order.  An
+    input set found not to be in time order is sorted first.  The
+    output set takes the ident of the set on the first input port.
+
+    Note, there is no IDepoSetFanin interface in WireCellIface so this
+    uses the generic fan-in node.
+ */
+
+#ifndef WIRECELL_GEN_DEPOSETFANIN
+#define WIRECELL_GEN_DEPOSETFANIN
+
+#include "WireCellIface/IFaninNode.h"
+#include "WireCellIface/IDepoSet.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellUtil/Logging.h"
+
+#include <vector>
+#include <string>
+
+namespace WireCell {
+    namespace Gen {
+
+        class DepoSetFanin : public IFaninNode<IDepoSet,IDepoSet,0>, public IConfigurable {
+        public:
+            DepoSetFanin(size_t multiplicity = 2);
+            virtual ~DepoSetFanin();
+
+            // INode, override because we get multiplicity at run time.
+            virtual std::vector<std::string> input_types();
+
+            // IFanin
+            virtual bool operator()(const input_vector& invec, output_pointer& out);
+
+            // IConfigurable
+            virtual void configure(const WireCell::Configuration& cfg);
+            virtual WireCell::Configuration default_configuration() const;
+
+        private:
+            size_t m_multiplicity;
+            Log::logptr_t log;
+        };
+    }
+}
+
+#endif
@@ -0,0 +1,74 @@
+/** A DepoSetRouter is a DepoSet fanout which, instead of sending the
+    same full set to every output port, sends to each port only the
+    depos which are inside the sensitive volume of one of the faces of
+    the anode associated with that port.
+
+    Each input depo is looked up once in a spatial index of all face
+    sensitive volumes so the cost is about linear in the number of
+    depos and nearly independent of the number of anodes.  A depo
+    inside faces of more than one anode is sent to each of them.
+    Depos inside no face are dropped.
+
+    The output ports follow the order of the "anodes" configuration
+    parameter.  Each output set carries the ident of the input set.
+ */
+
+#ifndef WIRECELL_GEN_DEPOSETROUTER
+#define WIRECELL_GEN_DEPOSETROUTER
+
+#include "WireCellIface/IDepoSetFanout.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellIface/IAnodePlane.h"
+#include "WireCellUtil/BoundingBox.h"
+#include "WireCellUtil/Logging.h"
+
+#include <vector>
+
+namespace WireCell {
+    namespace Gen {
+
+        class DepoSetRouter : public IDepoSetFanout, public IConfigurable {
+        public:
+            DepoSetRouter();
+            virtual ~DepoSetRouter();
+
+            // INode, override because we get multiplicity at run time.
+            virtual std::vector<std::string>  output_types();
+
+            // IFanout
+            virtual bool operator()(const input_pointer& in, output_vector& outv);
+
+            // IConfigurable
+            virtual void configure(const WireCell::Configuration& cfg);
+            virtual WireCell::Configuration default_configuration() const;
+
+        private:
+
+            IAnodePlane::vector m_anodes;
+
+            // One sensitive face volume and the output port it feeds.
+            struct FaceBox {
+                BoundingBox bb;
+                size_t port;
+            };
+            std::vector<FaceBox> m_faces;
+
+            // A uniform 3D grid over the union of all face volumes.
+            // Each cell lists the indices into m_faces of the faces
+            // which overlap it.
+            Point m_grid_origin;
+            double m_cell_size[3];
+            int m_ncells[3];
+            std::vector< std::vector<size_t> > m_cells;
+
+            void build_index();
+            // Return the cell holding the point or -1 if outside the grid.
+            int cell_index(const Point& pt) const;
+
+            Log::logptr_t log;
+        };
+    }
+}
+
+
+#endif
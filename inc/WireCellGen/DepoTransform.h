@@ -9,9 +9,15 @@
 #include "WireCellIface/IRandom.h"
 #include "WireCellIface/IPlaneImpactResponse.h"
 #include "WireCellIface/IAnodePlane.h"
+#include "WireCellGen/AnodePlane.h"
 #include "WireCellIface/WirePlaneId.h"
 #include "WireCellIface/IDepo.h"
 #include "WireCellUtil/Logging.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace WireCell {
     namespace Gen {
@@ -47,6 +53,27 @@ namespace WireCell {
             double m_drift_speed;
             double m_nsigma;
             int m_frame_count;
+            size_t m_max_memory;
+            bool m_roi_tiling;
+            bool m_split_response;
+
+            // Channel basis: waveforms are summed into one row per
+            // channel, indexed densely in anode channel order, and
+            // one trace per channel is made.  Channels which the
+            // anode does not list are appended.
+            bool m_channel_basis;
+            std::shared_ptr<const Gen::AnodePlane> m_ganode;
+            std::vector<int> m_channels;
+            std::unordered_map<int, size_t> m_channel_index;
+            size_t channel_row(int chid);
+
+            // Streaming mode: the number of ticks of response tail
+            // which are carried from one frame to the next and the
+            // carried tails by channel, starting at the next frame.
+            bool m_streaming;
+            int m_tail_ticks;
+            std::map<int, Waveform::realseq_t> m_carry;
+
             Log::logptr_t l;
 
         };
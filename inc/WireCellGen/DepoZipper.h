@@ -37,6 +37,8 @@ namespace WireCell {
             double m_drift_speed;
             double m_nsigma;
             int m_frame_count;
+            int m_nthreads;
+            int m_nshards;
 
         };
     }
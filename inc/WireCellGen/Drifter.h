@@ -5,10 +5,12 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IRandom.h"
 #include "WireCellUtil/Units.h"
+#include "WireCellUtil/Point.h"
 #include "WireCellUtil/Logging.h"
 
 
 #include <set>
+#include <vector>
 
 namespace WireCell {
 
@@ -35,6 +37,13 @@ namespace WireCell {
          * "response" and vice versa and at least one must be specified.
          * A "cathode" value must be specified.
          *
+         * An xregion may optionally be limited in the transverse
+         * directions by any of "ymin", "ymax", "zmin" and "zmax".
+         * This allows regions which overlap in X.  A depo is
+         * assigned to the first region, in the order given, which
+         * contains it in its response volume and otherwise to the
+         * first which contains it in its bulk volume.
+         *
          * Any depo not falling between "anode" and "cathode" will be
          * dropped.
          *
@@ -130,6 +139,9 @@ namespace WireCell {
                 m_lifetime = lifetime_to_set;
             };
 
+            // The random number generator used for fluctuations.
+            IRandom::pointer rng() const { return m_rng; }
+
         private:
 
             IRandom::pointer m_rng;
@@ -163,22 +175,32 @@ namespace WireCell {
                 typedef std::set<IDepo::pointer, DepoTimeCompare> ordered_depos_t;
                 ordered_depos_t depos; // buffer depos
 
+                // Optional transverse limits, default is unbounded.
+                double ymin, ymax, zmin, zmax;
+
                 bool inside_bulk(double x) const;
                 bool inside_response(double x) const;
+                bool inside_transverse(const Point& pt) const;
 
             };
             std::vector<Xregion> m_xregions;  
 
-            struct IsInsideBulk {
-                const input_pointer& depo;
-                IsInsideBulk(const input_pointer& depo) : depo(depo) {}
-                bool operator()(const Xregion& xr) const { return xr.inside_bulk(depo->pos().x()); }
-            };
-            struct IsInsideResp {
-                const input_pointer& depo;
-                IsInsideResp(const input_pointer& depo) : depo(depo) {}
-                bool operator()(const Xregion& xr) const { return xr.inside_response(depo->pos().x()); }
+            // An index of open X intervals.  The sorted, unique
+            // interval endpoints split the X axis into segments and
+            // each segment lists, in configuration order, the
+            // indices of the xregions which overlap it.  A lookup is
+            // a binary search followed by an exact check of the
+            // (usually one) candidate.
+            struct XIndex {
+                std::vector<double> edges;
+                std::vector< std::vector<size_t> > candidates;
+
+                void build(const std::vector< std::pair<double,double> >& intervals);
+                // Return candidates for the segment holding x, or nullptr.
+                const std::vector<size_t>* find(double x) const;
             };
+            XIndex m_resp_index, m_bulk_index;
+            void build_index();
 
             Log::logptr_t l;
         };                      // Drifter
@@ -34,6 +34,13 @@ namespace WireCell {
             virtual void configure(const WireCell::Configuration& config);
             virtual WireCell::Configuration default_configuration() const;
 
+            // Access the simulation parameters, eg so that a
+            // MultiDuctor may do the work of several Ductors at once.
+            const std::vector<IPlaneImpactResponse::pointer>& pirs() const { return m_pirs; }
+            IRandom::pointer rng() const { return m_rng; }
+            double nsigma() const { return m_nsigma; }
+            double drift_speed() const { return m_drift_speed; }
+
         protected:
 
             // The "Type:Name" of the IAnodePlane (default is "AnodePlane")
@@ -56,6 +63,8 @@ namespace WireCell {
             std::string m_mode;
 
             int m_frame_count;
+            int m_nthreads;
+            int m_nshards;
 
             virtual void process(output_queue& frames);
             virtual ITrace::vector process_face(IAnodeFace::pointer face,
@@ -16,6 +16,7 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IAnodePlane.h"
 #include "WireCellIface/IChannelStatus.h"
+#include "WireCellGen/AnodePlane.h"
 
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/Waveform.h"
@@ -88,6 +89,9 @@ namespace WireCell {
 	    
         private:
             IAnodePlane::pointer m_anode;
+            // Set if the anode is a Gen::AnodePlane, whose channel
+            // index gives plane and wire length without lookups.
+            std::shared_ptr<const Gen::AnodePlane> m_ganode;
             IChannelStatus::pointer m_chanstat;
 
             std::string m_spectra_file;
@@ -14,6 +14,8 @@
 
 #include "WireCellUtil/Configuration.h"
 
+#include <string>
+
 
 namespace WireCell {
     namespace Gen {
@@ -40,12 +42,21 @@ namespace WireCell {
             virtual void execute();
             virtual void execute_old();
             virtual void execute_new();
+            virtual void execute_threaded();
 
             virtual void configure(const WireCell::Configuration& config);
             virtual WireCell::Configuration default_configuration() const;
 
         private:
 
+            // Build the chain of procs and run it in one thread or
+            // with a thread per proc.
+            void execute_chain(bool threaded);
+
+            // Throw if distinct stages share an IRandom, as far as
+            // their types tell.
+            void check_rngs() const;
+
             WireCell::IDepoSource::pointer m_depos; // required
             WireCell::IDepoFilter::pointer m_depofilter; // optional
             WireCell::IDrifter::pointer m_drifter;       // optional, but likely
@@ -54,6 +65,9 @@ namespace WireCell {
             WireCell::IFrameFilter::pointer m_digitizer;  // optional
             WireCell::IFrameFilter::pointer m_filter;     // optional
             WireCell::IFrameSink::pointer m_output;       // optional
+
+            std::string m_executor;
+            size_t m_queue_capacity;
         };
     }
 }
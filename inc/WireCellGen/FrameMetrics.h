@@ -0,0 +1,43 @@
+/** FrameMetrics passes frames through unchanged and, for each one,
+ * takes the content of the Gen::Metrics registry and writes it as
+ * one line of JSON.  Configuring a FrameMetrics enables the registry.
+ *
+ * Place it at the end of a simulation chain so that the metrics
+ * reported by all upstream stages while producing a frame are
+ * written with that frame's ident.
+ */
+
+#ifndef WIRECELLGEN_FRAMEMETRICS
+#define WIRECELLGEN_FRAMEMETRICS
+
+#include "WireCellIface/IFrameFilter.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellUtil/Logging.h"
+
+#include <fstream>
+#include <string>
+
+namespace WireCell {
+    namespace Gen {
+
+        class FrameMetrics : public IFrameFilter, public IConfigurable {
+        public:
+            FrameMetrics();
+            virtual ~FrameMetrics();
+
+            /// IFrameFilter
+            virtual bool operator()(const input_pointer& inframe, output_pointer& outframe);
+
+            /// IConfigurable
+            virtual void configure(const WireCell::Configuration& config);
+            virtual WireCell::Configuration default_configuration() const;
+
+        private:
+            std::string m_filename;
+            std::ofstream m_out;
+            Log::logptr_t log;
+        };
+    }
+}
+
+#endif
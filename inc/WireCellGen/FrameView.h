@@ -0,0 +1,85 @@
+/** A FrameView is an IFrame which shares the trace vector of another
+    frame and holds only its own tags.
+
+    Frame plumbing which changes only tags (fanout, retagging) may
+    then make its output in time proportional to the number of tags
+    instead of the number of traces.  Tagged trace lists may be
+    given by value or taken by reference from another frame, which
+    the view then keeps alive.
+ */
+
+#ifndef WIRECELLGEN_FRAMEVIEW
+#define WIRECELLGEN_FRAMEVIEW
+
+#include "WireCellIface/IFrame.h"
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace WireCell {
+    namespace Gen {
+
+        class FrameView : public IFrame {
+        public:
+
+            /// A view of the parent's traces, ident and times but
+            /// with no tags and, as a SimpleFrame made from them
+            /// would have, no channel masks.
+            FrameView(const IFrame::pointer& parent);
+
+            /// A view of a shared trace vector.
+            FrameView(int ident, double time, double tick, ITrace::shared_vector traces,
+                      const Waveform::ChannelMaskMap& cmm = Waveform::ChannelMaskMap());
+
+            virtual ~FrameView();
+
+            /// Add a frame tag.
+            void tag_frame(const tag_t& tag);
+
+            /// Tag traces by their indices, copying the lists.
+            void tag_traces(const tag_t& tag, const trace_list_t& indices,
+                            const trace_summary_t& summary = trace_summary_t());
+
+            /// Tag traces with the list and summary which the other
+            /// frame has for its tag, without copying them.  The
+            /// other frame must share this view's trace vector or a
+            /// ValueError is thrown.
+            void tag_traces(const tag_t& tag, const IFrame::pointer& other, const tag_t& other_tag);
+
+            // IFrame
+            virtual int ident() const { return m_ident; }
+            virtual double time() const { return m_time; }
+            virtual double tick() const { return m_tick; }
+            virtual ITrace::shared_vector traces() const { return m_traces; }
+            virtual Waveform::ChannelMaskMap masks() const { return m_cmm; }
+            virtual const tag_list_t& frame_tags() const { return m_frame_tags; }
+            virtual const tag_list_t& trace_tags() const { return m_trace_tags; }
+            virtual const trace_list_t& tagged_traces(const tag_t& tag) const;
+            virtual const trace_summary_t& trace_summary(const tag_t& tag) const;
+
+        private:
+            int m_ident;
+            double m_time, m_tick;
+            ITrace::shared_vector m_traces;
+            Waveform::ChannelMaskMap m_cmm;
+
+            tag_list_t m_frame_tags, m_trace_tags;
+
+            // Trace tags point either into m_owned or into a frame
+            // held in m_others.
+            struct Tagged {
+                const trace_list_t* traces;
+                const trace_summary_t* summary;
+            };
+            std::unordered_map<tag_t, Tagged> m_tagged;
+            std::vector< std::shared_ptr<std::pair<trace_list_t, trace_summary_t> > > m_owned;
+            std::vector<IFrame::pointer> m_others;
+
+            void set_tagged(const tag_t& tag, const Tagged& tagged);
+        };
+
+    }
+}
+
+#endif
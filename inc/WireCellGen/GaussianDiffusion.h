@@ -8,6 +8,7 @@
 
 #include <memory>
 #include <iostream>
+#include <limits>
 
 namespace WireCell {
     namespace Gen {
@@ -102,6 +103,11 @@ namespace WireCell {
                               unsigned int weightstrat = 1/*see BinnedDiffusion ImpactDataCalculationStrategy*/);
 	    void clear_sampling();
 
+            /// Limit the pitch sampling to impact bins [lo, hi) of
+            /// the binning given to set_sampling(), as if the binning
+            /// ended there.  Call before set_sampling().
+            void set_pitch_window(int lo, int hi) { m_pwindow = std::make_pair(lo, hi); }
+
 	    /// Get the diffusion patch as an array of N_pitch rows X
 	    /// N_time columns.  Index as patch(i_pitch, i_time).
 	    /// Call set_sampling() first.
@@ -135,6 +141,7 @@ namespace WireCell {
 
             int m_toffset_bin;
             int m_poffset_bin;
+            std::pair<int,int> m_pwindow;
 	};
     }
 }
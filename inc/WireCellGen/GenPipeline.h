@@ -11,220 +11,305 @@
 #include "WireCellIface/IQueuedoutNode.h"
 #include "WireCellIface/IFunctionNode.h"
 #include "WireCellIface/ISourceNode.h"
+#include "WireCellIface/IDepo.h"
+#include "WireCellIface/IFrame.h"
 
-#include <queue>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
 #include <vector>
 
 
 namespace WireCell {
 
 
-typedef std::queue<boost::any> Pipe;
-
-// Base class for something that executes as a thunk.
-class Proc {
+// A typed, bounded, lock-free FIFO between exactly one producer
+// thread and exactly one consumer thread.  Elements are held in a ring
+// of power-of-two size and are not boxed.  The try_*() methods never
+// block.  The blocking push() and pop() wait, first spinning and then
+// backing off, until they can proceed or the pipe is closed.  Any
+// thread may close() the pipe.  After closing, push() fails and pop()
+// fails once the remaining elements are drained.
+//
+// If made to grow, a full pipe doubles its ring instead of refusing a
+// push.  This is only safe when producer and consumer are the same
+// thread, as in run_serial().
+template<typename T>
+class SpscPipe {
 public:
-    virtual ~Proc() {}
-    // Execute one operation of the process.
-    virtual bool operator()() = 0;
-};
+    typedef T value_type;
+
+    SpscPipe(size_t capacity = 64, bool grow = false)
+        : m_grow(grow), m_head(0), m_tail(0), m_closed(false) {
+        size_t size = 2;
+        while (size < capacity) { size <<= 1; }
+        m_ring.resize(size);
+        m_mask = size - 1;
+    }
 
-typedef std::vector<Proc*> Pipeline;
+    size_t capacity() const { return m_ring.size(); }
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+    // Producer side.
+    bool try_push(const T& item) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        if (tail - head >= m_ring.size()) {
+            if (!m_grow) {
+                return false;   // full
+            }
+            enlarge(head, tail);
+        }
+        m_ring[tail & m_mask] = item;
+        m_tail.store(tail+1, std::memory_order_release);
+        return true;
+    }
+    bool push(const T& item) {
+        for (size_t ntries=0; !closed(); ++ntries) {
+            if (try_push(item)) { return true; }
+            backoff(ntries);
+        }
+        return false;
+    }
 
-// Base class for something that pushes elements to a Pipe.
-class SourceProc : public virtual Proc {
-public:
-    virtual ~SourceProc() {}
-    // Return output Pipe
-    virtual Pipe& output_pipe() = 0;
-};
-// Base class for something that pops elements from a Pipe.
-class SinkProc : public virtual Proc {
-public:
-    virtual ~SinkProc() {}
-    // Return output Pipe
-    virtual Pipe& input_pipe() = 0;
-};
+    // Consumer side.
+    bool try_pop(T& item) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;       // empty
+        }
+        T& slot = m_ring[head & m_mask];
+        item = std::move(slot);
+        slot = T();             // drop the reference held by the ring
+        m_head.store(head+1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& item) {
+        for (size_t ntries=0; ; ++ntries) {
+            if (try_pop(item)) { return true; }
+            if (closed()) {
+                // The producer may have pushed just before closing.
+                return try_pop(item);
+            }
+            backoff(ntries);
+        }
+    }
 
+    void close() { m_closed.store(true, std::memory_order_release); }
+    bool closed() const { return m_closed.load(std::memory_order_acquire); }
 
-// Base class for something that intermediates between two pipes
-class FilterProc : public virtual SourceProc, public virtual SinkProc {
-public:
-    virtual ~FilterProc() {}
+private:
+    // Double the ring.  Element indices keep counting from where they
+    // were so only the mask changes.
+    void enlarge(size_t head, size_t tail) {
+        std::vector<T> ring(2*m_ring.size());
+        const size_t mask = ring.size() - 1;
+        for (size_t ind=head; ind<tail; ++ind) {
+            ring[ind & mask] = std::move(m_ring[ind & m_mask]);
+        }
+        m_ring.swap(ring);
+        m_mask = mask;
+    }
+
+    static void backoff(size_t ntries) {
+        if (ntries < 64) {
+            return;             // spin
+        }
+        if (ntries < 128) {
+            std::this_thread::yield();
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    std::vector<T> m_ring;
+    size_t m_mask;
+    bool m_grow;
+    // Keep the consumer and producer indices on separate cache lines.
+    char m_pad0[64];
+    std::atomic<size_t> m_head;
+    char m_pad1[64];
+    std::atomic<size_t> m_tail;
+    char m_pad2[64];
+    std::atomic<bool> m_closed;
 };
 
-// A filter pops one element from input pipe and pushes it to output
-// pipe each execution.
-class ShuntProc : public FilterProc
-{
+typedef SpscPipe<IDepo::pointer> DepoPipe;
+typedef SpscPipe<IFrame::pointer> FramePipe;
+
+
+// Base class for something that executes as a thunk.  A proc is
+// connected by typed pipes that it does not own.  Each call blocks
+// until it handles one element.  It returns false when its input is
+// exhausted, when its output is closed or when its node fails, which
+// failed() then tells.
+class Proc {
 public:
-    ShuntProc(Pipe& iq, Pipe& oq) :iq(iq), oq(oq) {}
-    virtual ~ShuntProc() {}
+    Proc() : m_failed(false) {}
+    virtual ~Proc() {}
 
-    virtual bool operator()() {
-        if (iq.empty()) { return false; }
-        oq.push(iq.front());
-        iq.pop();
-        return true;        
-    }
-    virtual Pipe& input_pipe() { return iq; }
-    virtual Pipe& output_pipe() { return oq; }
+    // Execute one operation of the process.
+    virtual bool operator()() = 0;
+
+    // True if an element waits in the input pipe.  A source has no
+    // input and is never ready in this sense.
+    virtual bool input_ready() const { return false; }
 
+    // Close any pipes the proc reads from or writes to.
+    virtual void close_input() {}
+    virtual void close_output() {}
+
+    bool failed() const { return m_failed; }
+protected:
+    bool fail() { m_failed = true; return false; }
 private:
-    Pipe& iq;
-    Pipe& oq;
+    bool m_failed;
 };
 
-// A proc which pops an input element, feeds it to a node and pushes the result.
-class FunctionNodeProc : public FilterProc {
+// A proc which produces one element using a node.  Input is exhausted
+// when the node returns false.
+template<typename Node>
+class SourceNodeProc : public Proc {
 public:
-    typedef typename WireCell::IFunctionNodeBase node_t;
-    typedef std::shared_ptr<node_t> node_pointer_t;
+    typedef SpscPipe<typename Node::output_pointer> output_pipe_t;
 
-    FunctionNodeProc(node_pointer_t node) : node(node) {}
-    virtual ~FunctionNodeProc() {}
-
-    virtual Pipe& input_pipe() {
-        return iq; 
-    }
-    virtual Pipe& output_pipe() {
-        return oq; 
-    }
+    SourceNodeProc(std::shared_ptr<Node> node, output_pipe_t& oq) : node(node), oq(oq) {}
+    virtual ~SourceNodeProc() {}
 
     virtual bool operator()() {
-        if (iq.empty()) { return false; }
-        boost::any anyout;
-        bool ok = (*node)(iq.front(), anyout);
-        if (!ok) return false;
-        iq.pop();
-        oq.push(anyout);
-        return true;        
+        typename Node::output_pointer out;
+        if (!(*node)(out)) { return false; }
+        return oq.push(out);
     }
+    virtual void close_output() { oq.close(); }
 
 private:
-    Pipe iq, oq;
-    node_pointer_t node;
-
+    std::shared_ptr<Node> node;
+    output_pipe_t& oq;
 };
 
-
-// A sink proc that pops and drops
-class DropSinkProc : public SinkProc
-{
+// A proc which pops an input element, feeds it to a node and pushes the result.
+template<typename Node>
+class FunctionNodeProc : public Proc {
 public:
-    DropSinkProc() {}
-    virtual ~DropSinkProc() {}
+    typedef SpscPipe<typename Node::input_pointer> input_pipe_t;
+    typedef SpscPipe<typename Node::output_pointer> output_pipe_t;
+
+    FunctionNodeProc(std::shared_ptr<Node> node, input_pipe_t& iq, output_pipe_t& oq)
+        : node(node), iq(iq), oq(oq) {}
+    virtual ~FunctionNodeProc() {}
 
     virtual bool operator()() {
-        if (iq.empty()) { return false; }
-        iq.pop();
-        return true;        
+        typename Node::input_pointer in;
+        if (!iq.pop(in)) { return false; }
+        typename Node::output_pointer out;
+        if (!(*node)(in, out)) { return fail(); }
+        return oq.push(out);
     }
-    virtual Pipe& input_pipe() { return iq; }
+    virtual bool input_ready() const { return !iq.empty(); }
+    virtual void close_input() { iq.close(); }
+    virtual void close_output() { oq.close(); }
 
 private:
-    Pipe iq;
+    std::shared_ptr<Node> node;
+    input_pipe_t& iq;
+    output_pipe_t& oq;
 };
 
-// A proc which produces one element using a node
-class SourceNodeProc : public SourceProc {
+// A proc which pops an input element, feeds it to a queued out node
+// and pushes each element of the resulting queue.
+template<typename Node>
+class QueuedNodeProc : public Proc {
 public:
-    typedef typename WireCell::ISourceNodeBase node_t;
-    typedef std::shared_ptr<node_t> node_pointer_t;
+    typedef SpscPipe<typename Node::input_pointer> input_pipe_t;
+    typedef SpscPipe<typename Node::output_pointer> output_pipe_t;
 
-    SourceNodeProc(node_pointer_t node) : node(node) {}
-    virtual ~SourceNodeProc() {}
-    
-    virtual Pipe& output_pipe() {
-        return oq; 
-    }
+    QueuedNodeProc(std::shared_ptr<Node> node, input_pipe_t& iq, output_pipe_t& oq)
+        : node(node), iq(iq), oq(oq) {}
+    virtual ~QueuedNodeProc() {}
 
     virtual bool operator()() {
-        boost::any anyout;
-        bool ok = (*node)(anyout);
-        if (!ok) return false;
-        oq.push(anyout);
-        return true;        
+        typename Node::input_pointer in;
+        if (!iq.pop(in)) { return false; }
+        typename Node::output_queue outq;
+        if (!(*node)(in, outq)) { return fail(); }
+        for (const auto& out : outq) {
+            if (!oq.push(out)) { return false; }
+        }
+        return true;
     }
+    virtual bool input_ready() const { return !iq.empty(); }
+    virtual void close_input() { iq.close(); }
+    virtual void close_output() { oq.close(); }
 
 private:
-    Pipe oq;
-    node_pointer_t node;
+    std::shared_ptr<Node> node;
+    input_pipe_t& iq;
+    output_pipe_t& oq;
 };
 
-// A proc which pops gives next element a node and pops it if node does puke.
-class SinkNodeProc : public SinkProc {
+// A proc which pops the next element and gives it to a node.
+template<typename Node>
+class SinkNodeProc : public Proc {
 public:
-    typedef typename WireCell::ISinkNodeBase node_t;
-    typedef std::shared_ptr<node_t> node_pointer_t;
+    typedef SpscPipe<typename Node::input_pointer> input_pipe_t;
 
-    SinkNodeProc(node_pointer_t node) : node(node) {}
+    SinkNodeProc(std::shared_ptr<Node> node, input_pipe_t& iq) : node(node), iq(iq) {}
     virtual ~SinkNodeProc() {}
-    
-    virtual Pipe& input_pipe() {
-        return iq; 
-    }
 
     virtual bool operator()() {
-        if (iq.empty()) { return false; }
-        bool ok = (*node)(iq.front());
-        if (!ok) return false;        
-        iq.pop();
-        return true;        
+        typename Node::input_pointer in;
+        if (!iq.pop(in)) { return false; }
+        if (!(*node)(in)) { return fail(); }
+        return true;
     }
+    virtual bool input_ready() const { return !iq.empty(); }
+    virtual void close_input() { iq.close(); }
 
 private:
-    Pipe iq;
-    node_pointer_t node;
+    std::shared_ptr<Node> node;
+    input_pipe_t& iq;
 };
 
-typedef std::deque<boost::any> queuedany;
-
-// A proc which pops an input element, feeds it to a node, assumes the
-// node is a queuedany, iterates over it and feeds individual elements
-// to the output queue.
-class QueuedNodeProc : public FilterProc {
+// A sink proc that pops and drops
+template<typename T>
+class DropSinkProc : public Proc {
 public:
-    typedef typename WireCell::IQueuedoutNodeBase node_t;
-    typedef std::shared_ptr<node_t> node_pointer_t;
-
-    QueuedNodeProc(node_pointer_t node) : node(node) {}
-    virtual ~QueuedNodeProc() {}
-
-    virtual Pipe& input_pipe() {
-        return iq; 
-    }
-    virtual Pipe& output_pipe() {
-        return oq; 
-    }
+    DropSinkProc(SpscPipe<T>& iq) : iq(iq) {}
+    virtual ~DropSinkProc() {}
 
     virtual bool operator()() {
-        if (iq.empty()) { return false; }
-        queuedany anyq;
-        bool ok = (*node)(iq.front(), anyq);
-        if (!ok) return false;
-        iq.pop();
-        for (auto anyo : anyq) {
-            oq.push(anyo);
-        }
-        return true;        
+        T in;
+        return iq.pop(in);
     }
+    virtual bool input_ready() const { return !iq.empty(); }
+    virtual void close_input() { iq.close(); }
 
 private:
-    Pipe iq, oq;
-    node_pointer_t node;
+    SpscPipe<T>& iq;
 };
 
-Proc* join(Pipeline& pipeline, Proc* src, Proc* dst)
-{
-    pipeline.push_back(src);
-    auto link = new ShuntProc(dynamic_cast<SourceProc*>(src)->output_pipe(),
-                              dynamic_cast<SinkProc*>(dst)->input_pipe());
-    pipeline.push_back(link);
-
-    // do not push dst.  return just for syntactic sugar
-    return dst;
-}
+// Execute a linear chain of procs in the calling thread.  A "drain end
+// first" strategy gives attention to draining pipes the more toward
+// the end of the chain they are.  This keeps the overall chain empty
+// and memory use low.  The source is called only when all pipes are
+// empty.  The pipes must be made to grow.  Return false if a proc
+// fails and true once the source is exhausted.
+bool run_serial(const std::vector<Proc*>& procs);
+
+// Execute a linear chain of procs with each on its own thread.  Each
+// proc is called until it returns false and then its output is closed
+// so that the next proc ends after draining its input.  If any proc
+// fails or throws, all pipes are closed so that all procs end early.
+// False is returned on failure and the first exception is rethrown
+// once all threads are joined.  Each proc is only ever called from one
+// thread but distinct procs must not share state which is not thread
+// safe.
+bool run_threaded(const std::vector<Proc*>& procs);
 
     
 
@@ -4,10 +4,15 @@
 #include "WireCellIface/IPlaneImpactResponse.h"
 #include "WireCellGen/BinnedDiffusion_transform.h"
 #include "WireCellUtil/Array.h"
+#include "WireCellUtil/Waveform.h"
 #include "WireCellUtil/Logging.h"
 
 #include <Eigen/Sparse>
 
+#include <map>
+#include <tuple>
+#include <vector>
+
 namespace WireCell {
     namespace Gen {
 
@@ -33,12 +38,80 @@ namespace WireCell {
 	    int m_end_ch;
 	    int m_start_tick;
 	    int m_end_tick;
-	    
+	    int m_npad_time;    // response padding in ticks
+
+            // When true, the 2D convolution uses the field response
+            // alone and the short responses are applied after, per
+            // wire, by convolving with m_short_waveform.
+            bool m_split;
+            Waveform::realseq_t m_short_waveform;
+
+            // A block of the charge domain which is convolved at once
+            // by a 2D FFT.  The result covers the block plus padding.
+            struct Tile {
+                int ch0, nch;
+                int tick0, ntick;
+            };
+            typedef std::tuple<int,int,double> charge_t;
+            typedef std::vector<charge_t>::const_iterator charge_iter;
+            typedef std::pair<charge_iter, charge_iter> charge_range;
+
+            // Truncated time spectra of each group's responses, by
+            // wire offset, keyed by (group, FFT length in ticks).
+            std::map<std::pair<int,int>, std::vector<Waveform::compseq_t> > m_resp_spectra;
+            // The leading samples of each response, keyed by (group,
+            // wire offset), kept while this transform is made.
+            std::map<std::pair<int,int>, Waveform::realseq_t> m_resp_heads;
+            const Waveform::realseq_t& response_head(int group, int off, int nkeep);
+
+            // Give the first wire, rows and columns of the padded
+            // array for a tile.
+            void tile_shape(const Tile& tile, int& ch_lo, int& nrows, int& ncols) const;
+            // Estimate the peak bytes used to convolve a tile.
+            size_t tile_bytes(const Tile& tile) const;
+            // Return the union of the padded tiles, which the output
+            // spans.
+            Tile tiles_union(const std::vector<Tile>& tiles) const;
+            // Return the bytes of the output over the tiles, after
+            // any short response is applied.
+            size_t output_bytes(const std::vector<Tile>& tiles) const;
+            // Split a box into a grid of tiles each within max_bytes.
+            void split_tile(const Tile& box, size_t max_bytes, std::vector<Tile>& tiles) const;
+            // Return disjoint boxes covering the occupied cells of a
+            // coarse grid over the domain.
+            std::vector<Tile> roi_tiles(const Tile& domain, const std::vector<bool>& occupied,
+                                        int ncells_ch, int ncells_tick) const;
+            // Size of the coarse grid cells in wires and ticks.
+            int m_cell_nch, m_cell_nticks;
+            const std::vector<Waveform::compseq_t>& response_spectra(int group, int ncols, int nkeep);
+            Array::array_xxc response_array(int group, int nrows, int ncols, int nkeep);
+            // Convolve the charges, one range per impact group, in
+            // the tile and add the result to m_decon_data.
+            void convolve_tile(const Tile& tile, const std::vector<charge_range>& charges, int nkeep);
+            // Convolve each wire of m_decon_data with the short
+            // responses, extending it in time by their length.
+            void apply_short_response();
+
             Log::logptr_t log;
 
         public:
 
-            ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedDiffusion_transform& bd);
+            /// Create the transform.  If max_bytes is positive the
+            /// charge domain is split into tiles convolved one at a
+            /// time so that, if possible, the memory used by the
+            /// output plus one tile stays below this many bytes.
+            /// Tiles are convolved in time with overlap-add and in
+            /// wire with a halo covering the response reach.  If roi
+            /// is true, only boxes around the occupied regions of the
+            /// wire-tick plane are convolved.
+            /// If split is true and the response is a
+            /// Gen::PlaneImpactResponse with short responses, the 2D
+            /// convolution uses the field response alone, with its
+            /// shorter padding, and the short responses are applied
+            /// per wire after.  Otherwise the combined response is
+            /// used.
+            ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedDiffusion_transform& bd,
+                            size_t max_bytes = 0, bool roi = false, bool split = false);
             virtual ~ImpactTransform();
 
             /// Return the wire's waveform.  If the response functions
@@ -53,6 +126,13 @@ namespace WireCell {
             // fixme: this should be a forward iterator so that it may cal bd.erase() safely to conserve memory
             Waveform::realseq_t waveform(int wire) const;
 
+            /// Return true if the wire may have a nonzero waveform.
+            bool covers(int wire) const { return wire >= m_start_ch && wire < m_end_ch; }
+
+            /// Add the wire's waveform to wave, which must have at
+            /// least as many samples as the time binning.
+            void add_waveform(int wire, Waveform::realseq_t& wave) const;
+
 
 	    
         };
@@ -2,8 +2,13 @@
 #define WIRECELL_IMPACTZIPPER
 
 #include "WireCellIface/IPlaneImpactResponse.h"
+#include "WireCellIface/ITrace.h"
+#include "WireCellIface/IWire.h"
 #include "WireCellGen/BinnedDiffusion.h"
 
+#include <utility>
+#include <vector>
+
 namespace WireCell {
     namespace Gen {
 
@@ -12,15 +17,28 @@ namespace WireCell {
          * along a wire plane convolving the response functions and
          * the local drifted charge distribution producing a waveform
          * on each central wire.
+         *
+         * It may be given several pairs of response and charge,
+         * such as for different regions of a plane, all on the same
+         * pimpos and time binning.  Their spectra are summed before
+         * one inverse transform per wire.
          */
         class ImpactZipper
         {
-            IPlaneImpactResponse::pointer m_pir;
-            BinnedDiffusion& m_bd;
+        public:
+            typedef std::pair<IPlaneImpactResponse::pointer, BinnedDiffusion*> source_t;
+
+        private:
+            std::vector<source_t> m_sources;
+
+            // Add the spectra of one source on the wire to total and
+            // return the number of impacts found.
+            int add_spectrum(const source_t& source, int wire, Waveform::compseq_t& total) const;
 
         public:
 
             ImpactZipper(IPlaneImpactResponse::pointer pir, BinnedDiffusion& bd);
+            ImpactZipper(const std::vector<source_t>& sources);
             virtual ~ImpactZipper();
 
             /// Return the wire's waveform.  If the response functions
@@ -37,6 +55,32 @@ namespace WireCell {
 
         };
 
+        /** Zip all wires of one plane and return a trace for each
+         * wire with any nonzero signal, in wire order.  The wires
+         * are those of the plane which the pimpos of the
+         * BinnedDiffusion describes.
+         *
+         * If nthreads is more than one, the wires are split into
+         * nshards contiguous shards (by default, four per thread) and
+         * each shard is zipped in its own thread with its own
+         * BinnedDiffusion subset holding the diffusions that fall
+         * within the shard's wires plus a halo of half the response
+         * pitch range.  Diffusions are sampled once, serially and in
+         * the order a serial zip uses, before any thread starts so
+         * that the output does not depend on the threading.
+         */
+        ITrace::vector zip_plane(IPlaneImpactResponse::pointer pir,
+                                 BinnedDiffusion& bd,
+                                 const IWire::vector& wires,
+                                 int nthreads = 1, int nshards = 0);
+
+        /** Zip all wires of one plane, summing the sources, and
+         * return a trace for each wire with any nonzero signal, in
+         * wire order.
+         */
+        ITrace::vector zip_plane(const std::vector<ImpactZipper::source_t>& sources,
+                                 const IWire::vector& wires);
+
     }  // Gen
 }  // WireCell
 #endif /* WIRECELL_IMPACTZIPPER */
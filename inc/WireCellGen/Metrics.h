@@ -0,0 +1,98 @@
+/** Gen::Metrics is a process wide registry into which gen components
+ * report simple performance measures of their "stages".  For each
+ * named stage it holds:
+ *
+ * - calls :: the number of timed calls
+ * - wall, cpu :: summed wall clock and thread CPU time (seconds)
+ * - counts :: summed counters such as depos in/out
+ * - peaks :: maximum values such as FFT sizes and bytes allocated
+ *
+ * Reporting is a no-op until something enables the registry (see
+ * FrameMetrics) so components may report unconditionally.  The
+ * content may be taken as JSON, eg once per event.
+ *
+ * Reporting is thread safe but the registry does not know about
+ * events.  When stages of different events run concurrently (eg,
+ * the "threaded" Fourdee executor) their reports are attributed to
+ * whichever event next takes the content.
+ */
+
+#ifndef WIRECELLGEN_METRICS
+#define WIRECELLGEN_METRICS
+
+#include "WireCellUtil/Configuration.h"
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace WireCell {
+    namespace Gen {
+
+        class Metrics {
+        public:
+
+            /// Access the process wide registry.
+            static Metrics& instance();
+
+            bool enabled() const { return m_enabled.load(std::memory_order_relaxed); }
+            void enable(bool on = true) { m_enabled = on; }
+
+            /// Record one call of the stage.
+            void call(const std::string& stage, double wall, double cpu);
+
+            /// Add to a counter of the stage.
+            void count(const std::string& stage, const std::string& name, double value = 1.0);
+
+            /// Raise a peak value of the stage, if value exceeds it.
+            void peak(const std::string& stage, const std::string& name, double value);
+
+            /// Return the current content as a JSON object keyed by
+            /// stage name.
+            Configuration json() const;
+
+            /// Forget the current content.
+            void clear();
+
+            /// Return the current content and forget it.
+            Configuration take();
+
+        private:
+            Metrics();
+
+            struct Stage {
+                size_t calls{0};
+                double wall{0}, cpu{0};
+                std::map<std::string, double> counts, peaks;
+            };
+            Configuration json_locked() const;
+
+            std::map<std::string, Stage> m_stages;
+            mutable std::mutex m_mutex;
+            std::atomic<bool> m_enabled;
+        };
+
+        /** Time the scope of an instance as one call of a stage.
+         */
+        class MetricsTimer {
+        public:
+            MetricsTimer(const std::string& stage);
+            ~MetricsTimer();
+
+            /// Return the CPU time in seconds used so far by the
+            /// calling thread.
+            static double thread_cpu();
+
+        private:
+            std::string m_stage;
+            bool m_enabled;
+            std::chrono::steady_clock::time_point m_wall0;
+            double m_cpu0;
+        };
+
+    }
+}
+
+#endif
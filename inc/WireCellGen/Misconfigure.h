@@ -13,6 +13,9 @@
  * signal for traces smaller than the time where the electronics
  * response functions are finite.
  *
+ * Traces of equal length are misconfigured together with one batch
+ * of FFTs and the ratio of response spectra is cached per length.
+ *
  * This component does not honor frame/trace tags.  No tags will be
  * considered on input and none are placed on output.
  *
@@ -25,6 +28,7 @@
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellUtil/Waveform.h"
 
+#include <map>
 #include <unordered_set>
 
 namespace WireCell {
@@ -45,6 +49,10 @@ namespace WireCell {
         private:
             Waveform::realseq_t  m_from, m_to;
             bool m_truncate;
+
+            // The spectrum of "to" over "from" by FFT length.
+            std::map<size_t, Waveform::compseq_t> m_ratio;
+            const Waveform::compseq_t& ratio_spectrum(size_t size);
         };
     }
 }
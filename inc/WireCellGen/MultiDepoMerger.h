@@ -0,0 +1,75 @@
+/** A MultiDepoMerger merges N time ordered streams of depos into one
+    time ordered stream.
+
+    It generalizes the two-port DepoMerger so that many sources
+    (signal, cosmics, radiologicals, etc) may be merged in one node
+    rather than through a chain of pairwise mergers.  The earliest
+    of the depos at the heads of the input ports is found with a
+    min-heap.  A depo is only output when every port which has not
+    yet reached EOS has a depo waiting so that the output remains
+    time ordered.  A port's EOS removes it from the merge and one EOS
+    is output after all ports have reached EOS.
+
+    Note, there is no dedicated N-input depo merger interface in
+    WireCellIface so this is a generic hydra node.
+ */
+
+#ifndef WIRECELL_GEN_MULTIDEPOMERGER
+#define WIRECELL_GEN_MULTIDEPOMERGER
+
+#include "WireCellIface/IHydraNode.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellIface/IDepo.h"
+#include "WireCellUtil/Logging.h"
+
+#include <queue>
+#include <vector>
+
+namespace WireCell {
+    namespace Gen {
+
+        class MultiDepoMerger : public IHydraNodeBase, public IConfigurable {
+        public:
+
+            MultiDepoMerger(size_t multiplicity = 2);
+            virtual ~MultiDepoMerger();
+
+            // INode, override because we get multiplicity at run time.
+            virtual std::string signature();
+            virtual std::vector<std::string> input_types();
+            virtual std::vector<std::string> output_types();
+
+            // IHydraNodeBase
+            virtual bool operator()(any_queue_vector& inqs,
+                                    any_queue_vector& outqs);
+
+            // IConfigurable
+            virtual void configure(const WireCell::Configuration& config);
+            virtual WireCell::Configuration default_configuration() const;
+
+        private:
+            size_t m_multiplicity;
+
+            // Heap entries are (time of head depo, port).
+            typedef std::pair<double, size_t> head_t;
+            std::priority_queue<head_t, std::vector<head_t>, std::greater<head_t> > m_heads;
+
+            // Per port, whether its head is in the heap and whether
+            // it has reached EOS.
+            std::vector<bool> m_loaded, m_done;
+            size_t m_ndone;
+
+            std::vector<size_t> m_nin;
+            size_t m_nout;
+            bool m_eos;
+
+            // Examine the head of a port's queue, if any, and put it
+            // in the heap or mark the port as done.
+            void load(size_t port, any_queue_type& inq);
+
+            Log::logptr_t log;
+        };
+    }
+}
+
+#endif
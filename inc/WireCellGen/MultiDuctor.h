@@ -5,6 +5,16 @@
     applied in turn to a depo until one matches.  On a match, the
     ductor associated with the rule is given the depo and subsequent
     iteration of the chain is abandoned.
+
+    In "single_pass" mode, the sub ductors must be Gen::Ductor and
+    MultiDuctor does their work itself.  Depos are routed by the same
+    rules but each plane is zipped once, summing over each sub
+    ductor's response and charge before one inverse transform per
+    wire.  There are then no sub frames to split and merge.  Only the
+    sub ductors' responses, rng, nsigma and drift_speed are used.
+    Their start_time, readout_time, continuous, fixed and
+    first_frame_number settings are ignored and MultiDuctor's own
+    readout is used for all of them.
  */
 
 #ifndef WIRECELLGEN_MULTIDUCTOR
@@ -13,8 +23,11 @@
 #include "WireCellIface/IDuctor.h"
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IAnodePlane.h"
+#include "WireCellGen/Ductor.h"
 
 #include <functional>
+#include <map>
+#include <memory>
 
 namespace WireCell {
     namespace Gen {
@@ -34,6 +47,9 @@ namespace WireCell {
             virtual void configure(const WireCell::Configuration& config);
             virtual WireCell::Configuration default_configuration() const;
 
+            // The random number generators of the sub ductors which
+            // are of type Gen::Ductor.
+            std::vector<IRandom::pointer> rngs() const;
 
         private:
 
@@ -50,24 +66,57 @@ namespace WireCell {
                 std::string name;
                 std::function<bool(IDepo::pointer depo)> check;
                 IDuctor::pointer ductor;
+                size_t index;   // into m_sp_ductors in single pass mode
                 SubDuctor(const std::string& tn,
                           std::function<bool(IDepo::pointer depo)> f,
-                          IDuctor::pointer d) : name(tn), check(f), ductor(d) {}
+                          IDuctor::pointer d, size_t ind=0) : name(tn), check(f), ductor(d), index(ind) {}
             };
             typedef std::vector<SubDuctor> ductorchain_t;
             std::vector<ductorchain_t> m_chains;            
             
             /// As sub ductors are called they will each return frames
             /// which are not in general synchronized with the others.
-            /// Their frames must be buffered here and released as a
-            /// merged frame in order for MultiDuctor to behave just
-            /// like a monolithic ductor.
-            output_queue m_frame_buffer;
+            /// Their traces are summed here, per channel, into a ring
+            /// of ticks starting at the current readout and released
+            /// as one frame in order for MultiDuctor to behave just
+            /// like a monolithic ductor.  The ring spans the readout
+            /// plus a tail as long as the longest sub ductor response.
+            /// Rows are made on first use and dropped once they hold
+            /// no more signal.  Samples past the ring are spilled and
+            /// added to it at a later readout.
+            struct RingRow {
+                std::vector<float> ring;
+                int last;       // last tick written, relative to readout start
+            };
+            std::map<int, RingRow> m_rows;
+            int m_ring_head;    // ring index of the readout start
+            double m_tail_time; // if negative, found from the responses
+            int m_tail_ticks;
+            struct Spill {
+                int channel;
+                int tbin;       // relative to readout start
+                std::vector<float> charge;
+            };
+            std::vector<Spill> m_spill;
+
+            // Single pass mode: the distinct sub ductors and the
+            // depos routed to each for the current readout.
+            bool m_single_pass;
+            std::vector<std::shared_ptr<Gen::Ductor> > m_sp_ductors;
+            std::vector<IDepo::vector> m_sp_depos;
+
+            // Make one frame from the routed depos.
+            void process_single_pass(output_queue& outframes);
 
             // local
 
-            // Accept new frames into the buffer
+            // Add new frames into the ring
             void merge(const output_queue& newframes);
+            // Add one channel's samples into the ring, spilling any
+            // past its end.  Return the number of samples before it.
+            size_t add_samples(int channel, int tbin, const std::vector<float>& charge);
+            int readout_ticks() const;
+            int ring_ticks() const;
 
             // Maybe extract output frames from the buffer.  If the
             // depo is past the next scheduled readout or if a nullptr
@@ -81,8 +130,6 @@ namespace WireCell {
             // processing.  Will set start time if in continuous mode.
             bool start_processing(const input_pointer& depo);
 
-            void dump_frame(const IFrame::pointer frame, std::string msg="Gen::MultiDuctor:");
-
         };
     }
 }
@@ -35,6 +35,9 @@ namespace WireCell {
             virtual void configure(const WireCell::Configuration& config);
             virtual WireCell::Configuration default_configuration() const;
 
+            /// Not in the interface.
+            IRandom::pointer rng() const { return m_rng; }
+
         private:
             IRandom::pointer m_rng;
             IAnodePlane::pointer m_anode;
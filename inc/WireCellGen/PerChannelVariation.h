@@ -10,6 +10,11 @@
  * signal for traces smaller than the time where the electronics
  * response functions are finite.
  *
+ * Each channel's response is fetched once, at first use.  Traces of
+ * equal length are processed together with one batch of FFTs.  If
+ * the "cache_spectra" option is true, the ratio spectrum of each
+ * channel is also kept, per length, trading memory for speed.
+ *
  * This component does not honor frame/trace tags.  No tags will be
  * considered on input and none are placed on output.
  *
@@ -24,6 +29,8 @@
 #include "WireCellUtil/Waveform.h"
 
 
+#include <map>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace WireCell {
@@ -47,6 +54,18 @@ namespace WireCell {
             int m_nsamples;
             WireCell::Waveform::realseq_t m_from;
             bool m_truncate;
+            bool m_cache_spectra;
+
+            // Channel responses, resized to m_nsamples, by channel.
+            std::unordered_map<int, Waveform::realseq_t> m_responses;
+            const Waveform::realseq_t& channel_response(int chid);
+
+            // Spectra of m_from by FFT length.
+            std::map<size_t, Waveform::compseq_t> m_from_spectra;
+            const Waveform::compseq_t& from_spectrum(size_t size);
+
+            // Ratio spectra by (channel, FFT length) if caching.
+            std::map<std::pair<int,size_t>, Waveform::compseq_t> m_ratio;
         };
     }
 }
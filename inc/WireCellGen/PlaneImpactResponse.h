@@ -8,6 +8,10 @@
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/Logging.h"
 
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
 namespace WireCell {
 
     namespace Gen {
@@ -16,33 +20,86 @@ namespace WireCell {
      * position (discrete position along the pitch direction of a
      * plane on which a response function is defined).  Note,
      * different physical positions may share the same ImpactResponse.
+     *
+     * Unless compact, all spectra are made on construction and
+     * never change after.  In compact mode only the half spectrum
+     * is made then and the full spectrum and waveform are made,
+     * once and under a lock, on first use.  Either way one
+     * ImpactResponse may be read from many threads.
      */
     class ImpactResponse : public IImpactResponse {
         int m_impact;
-	Waveform::compseq_t m_spectrum;
-	Waveform::realseq_t m_waveform;
+	int m_nticks;
+	bool m_compact;
+
+	// In compact mode only the non-negative frequencies are held
+	// and the full spectrum and waveform are made if asked for.
+	Waveform::compseq_t m_half;
+	mutable Waveform::compseq_t m_spectrum;
+	mutable Waveform::realseq_t m_waveform;
+	mutable std::once_flag m_full_once;
 	int m_waveform_pad;
 
-	Waveform::compseq_t m_long_spectrum;
-	Waveform::realseq_t m_long_waveform;
+	// The long response is the same for all impacts of a plane.
+	std::shared_ptr<const Waveform::realseq_t> m_long_waveform;
+	std::shared_ptr<const Waveform::compseq_t> m_long_spectrum;
 	int m_long_waveform_pad;
 
+	Waveform::realseq_t m_field_waveform;
+
+	void make_full() const;
+
     public:
-	ImpactResponse(int impact, const Waveform::realseq_t& wf, int waveform_pad, const Waveform::realseq_t& long_wf, int long_waveform_pad)
-	  : m_impact(impact), m_waveform(wf), m_waveform_pad(waveform_pad)
-	  , m_long_waveform(long_wf), m_long_waveform_pad(long_waveform_pad)
-	{}
+	typedef std::shared_ptr<const Waveform::realseq_t> shared_waveform_t;
+	typedef std::shared_ptr<const Waveform::compseq_t> shared_spectrum_t;
+
+	/// If spec is given it must be the spectrum of wf.
+	ImpactResponse(int impact, const Waveform::realseq_t& wf, int waveform_pad, const Waveform::realseq_t& long_wf, int long_waveform_pad,
+		       const Waveform::realseq_t& field_wf = Waveform::realseq_t(),
+		       const Waveform::compseq_t& spec = Waveform::compseq_t());
+
+	/// Give the response as a waveform, a spectrum or both.  The
+	/// long response and its spectrum are shared.  If compact,
+	/// only half of the (Hermitian) spectrum is kept.
+	ImpactResponse(int impact, const Waveform::realseq_t& wf, const Waveform::compseq_t& spec, int waveform_pad,
+		       shared_waveform_t long_wf, shared_spectrum_t long_spec, int long_waveform_pad,
+		       const Waveform::realseq_t& field_wf, bool compact);
+
+	/// Take a response made before, eg read from a cache, without
+	/// any transform.  The spectrum is given for bins 0 to
+	/// nticks/2 inclusive.  Unless compact, wf must be its
+	/// waveform.
+	ImpactResponse(int impact, int nticks, Waveform::realseq_t&& wf, Waveform::compseq_t&& half, int waveform_pad,
+		       shared_waveform_t long_wf, shared_spectrum_t long_spec, int long_waveform_pad,
+		       Waveform::realseq_t&& field_wf, bool compact);
 
 	/// Frequency-domain spectrum of response
 	const Waveform::compseq_t& spectrum();
-	const Waveform::realseq_t& waveform() const {return m_waveform;};
+	const Waveform::compseq_t& spectrum() const;
+	const Waveform::realseq_t& waveform() const;
 	int waveform_pad() const {return m_waveform_pad;};
 
-	const Waveform::compseq_t& long_aux_spectrum();
-	const Waveform::realseq_t& long_aux_waveform() const {return m_long_waveform;};
+	const Waveform::compseq_t& long_aux_spectrum() {return *m_long_spectrum;};
+	const Waveform::compseq_t& long_aux_spectrum() const {return *m_long_spectrum;};
+	const Waveform::realseq_t& long_aux_waveform() const {return *m_long_waveform;};
 	int long_aux_waveform_pad() const {return m_long_waveform_pad;};
-	
-	
+
+	/// Not in the interface.  The field response alone, as
+	/// induced charge per tick, before convolution with the short
+	/// responses.
+	const Waveform::realseq_t& field_waveform() const {return m_field_waveform;};
+
+	/// Not in the interface.  A copy of the first nsamples of
+	/// the waveform, or of the field waveform if field_only.  In
+	/// compact mode the full waveform is not kept.
+	Waveform::realseq_t waveform_head(int nsamples, bool field_only = false) const;
+
+	/// Not in the interface.  In compact mode, the spectrum for
+	/// frequency bins 0 to nticks()/2 inclusive.  Others are the
+	/// complex conjugates of these.  Empty if not compact.
+	bool compact() const { return m_compact; }
+	const Waveform::compseq_t& half_spectrum() const { return m_half; }
+	int nticks() const { return m_nticks; }
 
         /// Corresponding impact number
         int impact() const { return m_impact; }
@@ -101,6 +158,13 @@ namespace WireCell {
 	const wire_region_indicies_t& bywire_map() const { return m_bywire; }
 	std::pair<int,int> closest_wire_impact(double relpitch) const;
 
+	/// The product of the short responses as a waveform, empty if
+	/// there are none.  Convolving an impact response's
+	/// field_waveform() with this gives its waveform().
+	const Waveform::realseq_t& short_waveform() const { return m_short_waveform; }
+	/// The number of ticks spanned by the field response alone.
+	int field_pad() const { return m_field_pad; }
+
 
     private:
         std::string m_frname;
@@ -116,12 +180,28 @@ namespace WireCell {
 	wire_region_indicies_t m_bywire;
 
 	std::vector<IImpactResponse::pointer> m_ir;
+	Waveform::realseq_t m_short_waveform;
+	int m_field_pad;
 	double m_half_extent, m_pitch, m_impact;
 
+	// If set, impact responses keep only half spectra.
+	bool m_compact;
+
+	// If set, built responses are saved to and loaded from files
+	// in this directory, keyed by a hash of all the inputs.
+	std::string m_cache_dir;
+	// The file the field response is read from, to key the cache
+	// without loading it.
+	std::string m_field_file;
+
         Log::logptr_t l;
 
         void build_responses();
 
+	uint64_t cache_key() const;
+	bool load_cache(const std::string& path, uint64_t key);
+	void save_cache(const std::string& path, uint64_t key) const;
+
     };
 
 }}
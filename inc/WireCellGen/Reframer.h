@@ -33,10 +33,12 @@
 #include "WireCellIface/IFrameFilter.h"
 #include "WireCellIface/IConfigurable.h"
 #include "WireCellIface/IAnodePlane.h"
+#include "WireCellGen/AnodePlane.h"
 #include "WireCellUtil/Logging.h"
 
 #include <vector>
 #include <string>
+#include <unordered_map>
 
 namespace WireCell {
     namespace Gen {
@@ -60,6 +62,15 @@ namespace WireCell {
 
             double m_toffset, m_fill;
             int m_tbin, m_nticks;
+
+            // The anode channels in output order and the row of each
+            // in a dense (channels x nticks) sample buffer.  Rows are
+            // the anode's channel index if it is a Gen::AnodePlane.
+            std::shared_ptr<const Gen::AnodePlane> m_ganode;
+            std::vector<int> m_channels;
+            std::unordered_map<int, size_t> m_rows;
+            int channel_row(int chid) const;
+            std::vector<float> m_buffer;
             Log::logptr_t log;
         };
     }
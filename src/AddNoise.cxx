@@ -1,4 +1,5 @@
 #include "WireCellGen/AddNoise.h"
+#include "WireCellGen/Metrics.h"
 
 #include "WireCellIface/SimpleTrace.h"
 #include "WireCellIface/SimpleFrame.h"
@@ -64,6 +65,7 @@ bool Gen::AddNoise::operator()(const input_pointer& inframe, output_pointer& out
         outframe = nullptr;
         return true;
     }
+    MetricsTimer timer("AddNoise");
 
     ITrace::vector outtraces;
     for (const auto& intrace : *inframe->traces()) {
@@ -14,7 +14,9 @@
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/String.h"
 
+#include <algorithm>
 #include <string>
+#include <unordered_map>
 
 WIRECELL_FACTORY(AnodePlane, WireCell::Gen::AnodePlane,
                  WireCell::IAnodePlane, WireCell::IConfigurable)
@@ -27,6 +29,7 @@ using WireCell::String::format;
 
 Gen::AnodePlane::AnodePlane()
     : m_ident(0)
+    , m_chid_offset(0)
     , l(Log::logger("geom"))
 {
 }
@@ -144,6 +147,9 @@ void Gen::AnodePlane::configure(const WireCell::Configuration& cfg)
 
     // keep track which channels we know about in this anode.
     m_channels.clear();
+    std::unordered_map<int, int> c2wpid;
+    std::unordered_map<int, IWire::vector> c2wires;
+    std::unordered_map<int, IChannel::pointer> ichannels;
 
     const WireSchema::Anode& ws_anode = ws_store.anode(m_ident);
 
@@ -204,8 +210,8 @@ void Gen::AnodePlane::configure(const WireCell::Configuration& cfg)
                                                         iwire, chanid, ray,
                                                         ws_wire.segment);
                 wires[iwire] = iwireptr;
-                m_c2wires[chanid].push_back(iwireptr);
-                m_c2wpid[chanid] = wire_plane_id.ident();
+                c2wires[chanid].push_back(iwireptr);
+                c2wpid[chanid] = wire_plane_id.ident();
                 chwcollector(iwireptr);
             } // wire
 
@@ -235,7 +241,7 @@ void Gen::AnodePlane::configure(const WireCell::Configuration& cfg)
                     SimpleChannel* sch = chwcollector(chanid);
                     sch->set_index(plane_channels.size());
                     IChannel::pointer ich(sch);
-                    m_ichannels[chanid] = ich;
+                    ichannels[chanid] = ich;
                     plane_channels.push_back(ich);
                 }
             }
@@ -269,6 +275,63 @@ void Gen::AnodePlane::configure(const WireCell::Configuration& cfg)
     auto chend = std::unique(m_channels.begin(), m_channels.end());
     m_channels.resize( std::distance(m_channels.begin(), chend) );
 
+    // Lay out per channel information by channel index.
+    const size_t nchans = m_channels.size();
+    m_wpids.assign(nchans, WirePlaneId(0xFFFFFFFF).ident());
+    m_planes.assign(nchans, -1);
+    m_wire_lengths.assign(nchans, 0.0);
+    m_wires.assign(nchans, IWire::vector());
+    m_ichannels.assign(nchans, nullptr);
+    for (size_t ind=0; ind<nchans; ++ind) {
+        const int chid = m_channels[ind];
+        auto wpit = c2wpid.find(chid);
+        if (wpit != c2wpid.end()) {
+            m_wpids[ind] = wpit->second;
+            m_planes[ind] = WirePlaneId(wpit->second).index();
+        }
+        auto wit = c2wires.find(chid);
+        if (wit != c2wires.end()) {
+            m_wires[ind] = wit->second;
+            for (const auto& wire : wit->second) {
+                m_wire_lengths[ind] += ray_length(wire->ray());
+            }
+        }
+        auto cit = ichannels.find(chid);
+        if (cit != ichannels.end()) {
+            m_ichannels[ind] = cit->second;
+        }
+    }
+
+    // Use a direct lookup table unless the idents are sparse.
+    m_chid_table.clear();
+    m_chid_offset = 0;
+    if (nchans) {
+        const size_t span = m_channels.back() - m_channels.front() + 1;
+        if (span <= 4*nchans) {
+            m_chid_offset = m_channels.front();
+            m_chid_table.assign(span, -1);
+            for (size_t ind=0; ind<nchans; ++ind) {
+                m_chid_table[m_channels[ind] - m_chid_offset] = ind;
+            }
+        }
+    }
+}
+
+
+int Gen::AnodePlane::channel_index(int chident) const
+{
+    if (!m_chid_table.empty()) {
+        const int rel = chident - m_chid_offset;
+        if (rel < 0 || rel >= (int)m_chid_table.size()) {
+            return -1;
+        }
+        return m_chid_table[rel];
+    }
+    auto it = std::lower_bound(m_channels.begin(), m_channels.end(), chident);
+    if (it == m_channels.end() || *it != chident) {
+        return -1;
+    }
+    return it - m_channels.begin();
 }
 
 
@@ -287,20 +350,20 @@ WirePlaneId Gen::AnodePlane::resolve(int channel) const
 {
     const WirePlaneId bogus(0xFFFFFFFF);
 
-    auto got = m_c2wpid.find(channel);
-    if (got == m_c2wpid.end()) {
+    const int ind = channel_index(channel);
+    if (ind < 0) {
         return bogus;
     }
-    return WirePlaneId(got->second);
+    return WirePlaneId(m_wpids[ind]);
 }
 
 IChannel::pointer Gen::AnodePlane::channel(int chident) const
 {
-    auto it = m_ichannels.find(chident);
-    if (it == m_ichannels.end()) {
+    const int ind = channel_index(chident);
+    if (ind < 0) {
         return nullptr;
     }
-    return it->second;
+    return m_ichannels[ind];
 }
 
 std::vector<int> Gen::AnodePlane::channels() const
@@ -310,9 +373,9 @@ std::vector<int> Gen::AnodePlane::channels() const
 
 IWire::vector Gen::AnodePlane::wires(int channel) const
 {
-    auto it = m_c2wires.find(channel);
-    if (it == m_c2wires.end()) {
+    const int ind = channel_index(channel);
+    if (ind < 0) {
         return IWire::vector();
     }
-    return it->second;
+    return m_wires[ind];
 }
@@ -0,0 +1,243 @@
+#include "WireCellGen/BatchDepoTransform.h"
+#include "WireCellGen/ImpactTransform.h"
+#include "WireCellGen/BinnedDiffusion_transform.h"
+#include "WireCellGen/Metrics.h"
+#include "WireCellIface/SimpleDepo.h"
+#include "WireCellIface/SimpleTrace.h"
+#include "WireCellIface/SimpleFrame.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/Units.h"
+#include "WireCellUtil/Pimpos.h"
+
+WIRECELL_FACTORY(BatchDepoTransform, WireCell::Gen::BatchDepoTransform,
+                 WireCell::INode, WireCell::IConfigurable)
+
+using namespace WireCell;
+using namespace std;
+
+Gen::BatchDepoTransform::BatchDepoTransform()
+    : m_start_time(0.0*units::ns)
+    , m_readout_time(5.0*units::ms)
+    , m_tick(0.5*units::us)
+    , m_drift_speed(1.0*units::mm/units::us)
+    , m_nsigma(3.0)
+    , m_frame_count(0)
+    , m_batch_size(8)
+    , m_max_memory(0)
+    , m_roi_tiling(true)
+    , m_split_response(false)
+    , l(Log::logger("sim"))
+{
+}
+
+Gen::BatchDepoTransform::~BatchDepoTransform()
+{
+}
+
+void Gen::BatchDepoTransform::configure(const WireCell::Configuration& cfg)
+{
+    auto anode_tn = get<string>(cfg, "anode", "");
+    m_anode = Factory::find_tn<IAnodePlane>(anode_tn);
+
+    m_nsigma = get<double>(cfg, "nsigma", m_nsigma);
+    bool fluctuate = get<bool>(cfg, "fluctuate", false);
+    m_rng = nullptr;
+    if (fluctuate) {
+        auto rng_tn = get<string>(cfg, "rng", "");
+        m_rng = Factory::find_tn<IRandom>(rng_tn);
+    }
+
+    m_readout_time = get<double>(cfg, "readout_time", m_readout_time);
+    m_tick = get<double>(cfg, "tick", m_tick);
+    m_start_time = get<double>(cfg, "start_time", m_start_time);
+    m_drift_speed = get<double>(cfg, "drift_speed", m_drift_speed);
+    m_frame_count = get<int>(cfg, "first_frame_number", m_frame_count);
+    m_max_memory = get<double>(cfg, "max_memory", (double)m_max_memory);
+    m_roi_tiling = get<bool>(cfg, "roi_tiling", m_roi_tiling);
+    m_split_response = get<bool>(cfg, "split_response", m_split_response);
+    m_batch_size = std::max(1, get<int>(cfg, "batch_size", (int)m_batch_size));
+
+    auto jpirs = cfg["pirs"];
+    if (jpirs.isNull() or jpirs.empty()) {
+        std::string msg = "must configure with some plane impact response components";
+        l->error(msg);
+        THROW(ValueError() << errmsg{"Gen::BatchDepoTransform: " + msg});
+    }
+    m_pirs.clear();
+    for (auto jpir : jpirs) {
+        auto tn = jpir.asString();
+        auto pir = Factory::find_tn<IPlaneImpactResponse>(tn);
+        m_pirs.push_back(pir);
+    }
+    m_batch.clear();
+}
+
+WireCell::Configuration Gen::BatchDepoTransform::default_configuration() const
+{
+    Configuration cfg;
+
+    /// How many depo sets to convolve together.
+    put(cfg, "batch_size", (int)m_batch_size);
+
+    /// How many Gaussian sigma due to diffusion to keep before truncating.
+    put(cfg, "nsigma", m_nsigma);
+
+    /// Whether to fluctuate the final Gaussian deposition.
+    put(cfg, "fluctuate", false);
+
+    /// The open a gate.  This is actually a "readin" time measured at
+    /// the input ("reference") plane.  It is common to all events.
+    put(cfg, "start_time", m_start_time);
+
+    /// The time span for each readout.
+    put(cfg, "readout_time", m_readout_time);
+
+    /// The sample period
+    put(cfg, "tick", m_tick);
+
+    /// The nominal speed of drifting electrons
+    put(cfg, "drift_speed", m_drift_speed);
+
+    /// Allow for a custom starting frame number
+    put(cfg, "first_frame_number", m_frame_count);
+
+    /// As for DepoTransform, applied to the stacked plane.
+    put(cfg, "max_memory", (double)m_max_memory);
+
+    /// As for DepoTransform.  On by default here as the stacked
+    /// plane is mostly the empty gaps between events.
+    put(cfg, "roi_tiling", m_roi_tiling);
+
+    /// As for DepoTransform.
+    put(cfg, "split_response", m_split_response);
+
+    /// Name of component providing the anode plane.
+    put(cfg, "anode", "");
+    /// Name of component providing the anode pseudo random number generator.
+    put(cfg, "rng", "");
+
+    /// Plane impact responses
+    cfg["pirs"] = Json::arrayValue;
+
+    return cfg;
+}
+
+bool Gen::BatchDepoTransform::operator()(const input_pointer& in, output_queue& outq)
+{
+    if (!in) {
+        flush(outq);
+        outq.push_back(nullptr);
+        return true;
+    }
+    m_batch.push_back(in);
+    if (m_batch.size() >= m_batch_size) {
+        flush(outq);
+    }
+    return true;
+}
+
+void Gen::BatchDepoTransform::flush(output_queue& outq)
+{
+    const size_t nevents = m_batch.size();
+    if (!nevents) {
+        return;
+    }
+
+    MetricsTimer timer("BatchDepoTransform");
+    auto& metrics = Metrics::instance();
+    metrics.count("BatchDepoTransform", "events", nevents);
+
+    Binning tbins(m_readout_time/m_tick, m_start_time, m_start_time+m_readout_time);
+    std::vector<ITrace::vector> traces(nevents);
+
+    for (auto face : m_anode->faces()) {
+        auto bb = face->sensitive();
+        if (bb.empty()) {
+            l->debug("anode {} face {} is marked insensitive, skipping",
+                     m_anode->ident(), face->ident());
+            continue;
+        }
+
+        std::vector<IDepo::vector> face_depos(nevents);
+        size_t nface = 0;
+        for (size_t iev=0; iev<nevents; ++iev) {
+            for (auto depo : *(m_batch[iev]->depos())) {
+                if (bb.inside(depo->pos())) {
+                    face_depos[iev].push_back(depo);
+                }
+            }
+            nface += face_depos[iev].size();
+        }
+        if (!nface) {
+            continue;
+        }
+
+        int iplane = -1;
+        for (auto plane : face->planes()) {
+            ++iplane;
+            auto pir = m_pirs.at(iplane);
+
+            // The stacked plane repeats this one every "stride" wires.
+            const Pimpos* pimpos = plane->pimpos();
+            const auto rb = pimpos->region_binning();
+            const int nwires = rb.nbins();
+            const double pitch = rb.binsize();
+            const int stride = nwires + pir->nwires();
+            const int nstacked = (nevents-1)*stride + nwires;
+            const int nimpacts = pimpos->impact_binning().nbins() / nwires;
+            const double pitchmin = rb.min() + 0.5*pitch;
+            Pimpos stacked(nstacked, pitchmin, pitchmin + (nstacked-1)*pitch,
+                           pimpos->axis(1), pimpos->axis(2), pimpos->origin(), nimpacts);
+
+            // Each event's depos are judged against, and their charge
+            // kept within, the impacts of its own copy of the plane,
+            // as if it were alone.  Charge diffusing into the gap
+            // would otherwise reach the edge wires of its neighbours.
+            Gen::BinnedDiffusion_transform bindiff(stacked, tbins, m_nsigma, m_rng);
+            for (size_t iev=0; iev<nevents; ++iev) {
+                const Vector shift = pimpos->axis(2) * (iev*stride*pitch);
+                const int imp_lo = iev*stride*nimpacts;
+                const auto impacts = std::make_pair(imp_lo, imp_lo + nwires*nimpacts);
+                for (auto depo : face_depos[iev]) {
+                    depo = modify_depo(plane->planeid(), depo);
+                    if (iev) {
+                        depo = make_shared<SimpleDepo>(depo->time(), depo->pos() + shift,
+                                                       depo->charge(), depo,
+                                                       depo->extent_long(), depo->extent_tran());
+                    }
+                    bindiff.add(depo, depo->extent_long() / m_drift_speed, depo->extent_tran(), impacts);
+                }
+            }
+            metrics.count("BatchDepoTransform", "outside_pitch", bindiff.outside_pitch());
+            metrics.count("BatchDepoTransform", "outside_time", bindiff.outside_time());
+
+            Gen::ImpactTransform transform(pir, bindiff, m_max_memory, m_roi_tiling, m_split_response);
+
+            auto& wires = plane->wires();
+            for (size_t iev=0; iev<nevents; ++iev) {
+                for (int iwire=0; iwire<nwires; ++iwire) {
+                    const int iwire_stacked = iev*stride + iwire;
+                    if (!transform.covers(iwire_stacked)) {
+                        continue;
+                    }
+                    auto wave = transform.waveform(iwire_stacked);
+                    auto mm = Waveform::edge(wave);
+                    if (mm.first == (int)wave.size()) { // all zero
+                        continue;
+                    }
+                    ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
+                    traces[iev].push_back(make_shared<SimpleTrace>(wires[iwire]->channel(), mm.first, charge));
+                }
+            }
+        }
+    }
+
+    for (size_t iev=0; iev<nevents; ++iev) {
+        metrics.count("BatchDepoTransform", "traces_out", traces[iev].size());
+        outq.push_back(make_shared<SimpleFrame>(m_frame_count, m_start_time, traces[iev], m_tick));
+        ++m_frame_count;
+    }
+    l->debug("BatchDepoTransform: simulated {} events in one batch", nevents);
+    m_batch.clear();
+}
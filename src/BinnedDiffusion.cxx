@@ -19,6 +19,7 @@ Gen::BinnedDiffusion::BinnedDiffusion(const Pimpos& pimpos, const Binning& tbins
     , m_window(0,0)
     , m_outside_pitch(0)
     , m_outside_time(0)
+    , m_sampled(false)
 {
 }
 
@@ -127,9 +128,11 @@ Gen::ImpactData::pointer Gen::BinnedDiffusion::impact_data(int bin) const
     auto idptr = it->second;
 
     // make sure all diffusions have been sampled 
-    for (auto diff : idptr->diffusions()) {
-      diff->set_sampling(m_tbins, ib, m_nsigma, m_fluctuate, m_calcstrat);
-      //diff->set_sampling(m_tbins, ib, m_nsigma, 0, m_calcstrat);
+    if (!m_sampled) {
+        for (auto diff : idptr->diffusions()) {
+            diff->set_sampling(m_tbins, ib, m_nsigma, m_fluctuate, m_calcstrat);
+            //diff->set_sampling(m_tbins, ib, m_nsigma, 0, m_calcstrat);
+        }
     }
 
     idptr->calculate(m_tbins.nbins());
@@ -137,6 +140,34 @@ Gen::ImpactData::pointer Gen::BinnedDiffusion::impact_data(int bin) const
 }
 
 
+void Gen::BinnedDiffusion::sample_all()
+{
+    const auto ib = m_pimpos.impact_binning();
+    for (auto& it : m_impacts) {
+        for (auto diff : it.second->diffusions()) {
+            diff->set_sampling(m_tbins, ib, m_nsigma, m_fluctuate, m_calcstrat);
+        }
+    }
+    m_sampled = true;
+}
+
+std::shared_ptr<Gen::BinnedDiffusion>
+Gen::BinnedDiffusion::subset(int begin_impact_number, int end_impact_number) const
+{
+    auto ret = std::make_shared<BinnedDiffusion>(m_pimpos, m_tbins, m_nsigma,
+                                                 m_fluctuate, m_calcstrat);
+    auto beg = m_impacts.lower_bound(begin_impact_number);
+    auto end = m_impacts.lower_bound(end_impact_number);
+    for (auto it = beg; it != end; ++it) {
+        for (auto diff : it->second->diffusions()) {
+            ret->add(diff, it->first);
+        }
+    }
+    ret->m_sampled = m_sampled;
+    return ret;
+}
+
+
 static
 std::pair<double,double> gausdesc_range(const std::vector<Gen::GausDesc> gds, double nsigma)
 {
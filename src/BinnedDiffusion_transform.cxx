@@ -35,6 +35,12 @@ Gen::BinnedDiffusion_transform::BinnedDiffusion_transform(const Pimpos& pimpos,
 }
 
 bool Gen::BinnedDiffusion_transform::add(IDepo::pointer depo, double sigma_time, double sigma_pitch)
+{
+    return add(depo, sigma_time, sigma_pitch, std::make_pair(0, m_pimpos.impact_binning().nbins()));
+}
+
+bool Gen::BinnedDiffusion_transform::add(IDepo::pointer depo, double sigma_time, double sigma_pitch,
+                                         std::pair<int,int> impacts)
 {
 
     const double center_time = depo->time();
@@ -58,11 +64,14 @@ bool Gen::BinnedDiffusion_transform::add(IDepo::pointer depo, double sigma_time,
     }
 
     auto ibins = m_pimpos.impact_binning();
+    const bool whole = impacts.first <= 0 && impacts.second >= ibins.nbins();
+    const double pmin = impacts.first <= 0 ? ibins.min() : ibins.edge(impacts.first);
+    const double pmax = impacts.second >= ibins.nbins() ? ibins.max() : ibins.edge(impacts.second);
 
     Gen::GausDesc pitch_desc(center_pitch, sigma_pitch);
     {
-        double nmin_sigma = pitch_desc.distance(ibins.min());
-        double nmax_sigma = pitch_desc.distance(ibins.max());
+        double nmin_sigma = pitch_desc.distance(pmin);
+        double nmax_sigma = pitch_desc.distance(pmax);
 
         double eff_nsigma = sigma_pitch>0?m_nsigma:0;
         if (nmin_sigma > eff_nsigma || nmax_sigma < -eff_nsigma) {
@@ -85,6 +94,9 @@ bool Gen::BinnedDiffusion_transform::add(IDepo::pointer depo, double sigma_time,
     //cerr << "DEBUG bin_center: "<<bin_center<<endl;
 
     auto gd = std::make_shared<GaussianDiffusion>(depo, time_desc, pitch_desc);
+    if (!whole) {
+        gd->set_pitch_window(impacts.first, impacts.second);
+    }
     // for (int bin = bin_beg; bin < bin_end; ++bin) {
     //   //   if (bin == bin_beg)  m_diffs.insert(gd);
     //   this->add(gd, bin);
@@ -1,12 +1,14 @@
 #include "WireCellGen/DepoPlaneX.h"
 #include "WireCellGen/TransportedDepo.h"
 
+#include <algorithm>
+
 using namespace WireCell;
 
 Gen::DepoPlaneX::DepoPlaneX(double planex, double speed)
     : m_planex(planex)
     , m_speed(speed)
-    , m_queue(IDepoDriftCompare(speed))
+    , m_compare(speed)
 {
 }
 
@@ -15,7 +17,9 @@ IDepo::pointer Gen::DepoPlaneX::add(const IDepo::pointer& depo)
 {
     drain(depo->time());
     IDepo::pointer newdepo(new TransportedDepo(depo, m_planex, m_speed));
-    m_queue.insert(newdepo);
+    m_queue.push_back(newdepo);
+    std::push_heap(m_queue.begin(), m_queue.end(),
+                   [this](const IDepo::pointer& a, const IDepo::pointer& b) { return later(a,b); });
     return newdepo;
 }
 
@@ -27,30 +31,25 @@ double Gen::DepoPlaneX::freezeout_time() const
     return m_frozen.back()->time();
 }
 
+void Gen::DepoPlaneX::freeze_one()
+{
+    std::pop_heap(m_queue.begin(), m_queue.end(),
+                  [this](const IDepo::pointer& a, const IDepo::pointer& b) { return later(a,b); });
+    m_frozen.push_back(m_queue.back());
+    m_queue.pop_back();
+}
+
 void Gen::DepoPlaneX::drain(double time)
 {
-    IDepo::vector doomed;
-    for (auto depo : m_queue) {
-	if (depo->time() < time) {
-	    m_frozen.push_back(depo);
-            doomed.push_back(depo);
-	}
-    }
-    for (auto depo : doomed) {
-        m_queue.erase(depo);
+    while (!m_queue.empty() and m_queue.front()->time() < time) {
+        freeze_one();
     }
 }
 
 void Gen::DepoPlaneX::freezeout()
 {
-    IDepo::vector doomed;
-    for (auto depo : m_queue) {
-	m_frozen.push_back(depo);
-        doomed.push_back(depo);
-
-    }
-    for (auto depo : doomed) {
-        m_queue.erase(depo);
+    while (!m_queue.empty()) {
+        freeze_one();
     }
 }
 
@@ -0,0 +1,122 @@
+#include "WireCellGen/DepoSetFanin.h"
+
+#include "WireCellIface/SimpleDepoSet.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <algorithm>
+#include <queue>
+#include <tuple>
+
+WIRECELL_FACTORY(DepoSetFanin, WireCell::Gen::DepoSetFanin,
+                 WireCell::INode, WireCell::IConfigurable)
+
+
+using namespace WireCell;
+
+Gen::DepoSetFanin::DepoSetFanin(size_t multiplicity)
+    : m_multiplicity(multiplicity)
+    , log(Log::logger("glue"))
+{
+}
+Gen::DepoSetFanin::~DepoSetFanin()
+{
+}
+
+WireCell::Configuration Gen::DepoSetFanin::default_configuration() const
+{
+    Configuration cfg;
+    /// Number of input depo sets.
+    cfg["multiplicity"] = (int)m_multiplicity;
+    return cfg;
+}
+void Gen::DepoSetFanin::configure(const WireCell::Configuration& cfg)
+{
+    int m = get<int>(cfg, "multiplicity", (int)m_multiplicity);
+    if (m<=0) {
+        log->critical("DepoSetFanin multiplicity must be positive");
+        THROW(ValueError() << errmsg{"DepoSetFanin multiplicity must be positive"});
+    }
+    m_multiplicity = m;
+}
+
+std::vector<std::string> Gen::DepoSetFanin::input_types()
+{
+    const std::string tname = std::string(typeid(input_type).name());
+    std::vector<std::string> ret(m_multiplicity, tname);
+    return ret;
+}
+
+static
+bool by_time(const IDepo::pointer& lhs, const IDepo::pointer& rhs)
+{
+    return lhs->time() < rhs->time();
+}
+
+bool Gen::DepoSetFanin::operator()(const input_vector& invec, output_pointer& out)
+{
+    out = nullptr;
+    if (invec.size() != m_multiplicity) {
+        log->critical("DepoSetFanin: got {} inputs, expect {}",
+                      invec.size(), m_multiplicity);
+        THROW(ValueError() << errmsg{"DepoSetFanin: unexpected number of inputs"});
+    }
+
+    // Collect the input sequences, sorting any which need it.
+    std::vector<IDepo::shared_vector> keep; // holds any sorted copies
+    std::vector<const IDepo::vector*> seqs;
+    size_t ntotal = 0;
+    int ident = -1;
+    bool ident_set = false;
+    for (auto ds : invec) {
+        if (!ds) {
+            continue;
+        }
+        if (!ident_set) {
+            ident = ds->ident();
+            ident_set = true;
+        }
+        auto depos = ds->depos();
+        if (!depos or depos->empty()) {
+            continue;
+        }
+        if (!std::is_sorted(depos->begin(), depos->end(), by_time)) {
+            auto sorted = std::make_shared<IDepo::vector>(depos->begin(), depos->end());
+            std::stable_sort(sorted->begin(), sorted->end(), by_time);
+            depos = sorted;
+        }
+        keep.push_back(depos);
+        seqs.push_back(depos.get());
+        ntotal += depos->size();
+    }
+    if (!ident_set) {
+        log->debug("DepoSetFanin: EOS");
+        return true;            // all EOS
+    }
+
+    IDepo::vector merged;
+    merged.reserve(ntotal);
+
+    // k-way merge.  Heap entries are (time, sequence, index).
+    typedef std::tuple<double, size_t, size_t> head_t;
+    std::priority_queue<head_t, std::vector<head_t>, std::greater<head_t> > heads;
+    for (size_t iseq=0; iseq<seqs.size(); ++iseq) {
+        heads.push(head_t(seqs[iseq]->front()->time(), iseq, 0));
+    }
+    while (!heads.empty()) {
+        const auto top = heads.top();
+        heads.pop();
+        const size_t iseq = std::get<1>(top);
+        const size_t ind = std::get<2>(top);
+        const auto& seq = *seqs[iseq];
+        merged.push_back(seq[ind]);
+        if (ind+1 < seq.size()) {
+            heads.push(head_t(seq[ind+1]->time(), iseq, ind+1));
+        }
+    }
+
+    log->debug("DepoSetFanin: ({}) merged {} depos from {} sets",
+               ident, merged.size(), seqs.size());
+    out = std::make_shared<SimpleDepoSet>(ident, merged);
+    return true;
+}
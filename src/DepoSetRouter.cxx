@@ -0,0 +1,228 @@
+#include "WireCellGen/DepoSetRouter.h"
+
+#include "WireCellIface/SimpleDepoSet.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/Units.h"
+
+#include <algorithm>
+#include <cmath>
+
+WIRECELL_FACTORY(DepoSetRouter, WireCell::Gen::DepoSetRouter,
+                 WireCell::IDepoSetFanout, WireCell::IConfigurable)
+
+
+using namespace WireCell;
+using namespace std;
+
+// Limit on the number of grid cells along any one axis.
+static const int max_cells_per_axis = 256;
+
+static
+double coord(const Point& pt, int axis)
+{
+    if (axis == 0) return pt.x();
+    if (axis == 1) return pt.y();
+    return pt.z();
+}
+
+
+Gen::DepoSetRouter::DepoSetRouter()
+    : log(Log::logger("glue"))
+{
+    for (int axis=0; axis<3; ++axis) {
+        m_cell_size[axis] = 0;
+        m_ncells[axis] = 0;
+    }
+}
+
+Gen::DepoSetRouter::~DepoSetRouter()
+{
+}
+
+
+WireCell::Configuration Gen::DepoSetRouter::default_configuration() const
+{
+    Configuration cfg;
+
+    /// The anode planes to route to.  Depos in the sensitive volume
+    /// of the N-th anode's faces are sent out the N-th output port.
+    cfg["anodes"] = Json::arrayValue;
+
+    return cfg;
+}
+
+void Gen::DepoSetRouter::configure(const WireCell::Configuration& cfg)
+{
+    auto janodes = cfg["anodes"];
+    if (janodes.isNull() or janodes.empty()) {
+        log->critical("DepoSetRouter must be given at least one anode");
+        THROW(ValueError() << errmsg{"DepoSetRouter must be given at least one anode"});
+    }
+    m_anodes.clear();
+    for (auto janode : janodes) {
+        m_anodes.push_back(Factory::find_tn<IAnodePlane>(janode.asString()));
+    }
+
+    m_faces.clear();
+    for (size_t port=0; port<m_anodes.size(); ++port) {
+        for (auto face : m_anodes[port]->faces()) {
+            if (!face) {
+                continue;
+            }
+            auto bb = face->sensitive();
+            if (bb.empty()) {
+                continue;
+            }
+            m_faces.push_back(FaceBox{bb, port});
+        }
+    }
+    build_index();
+}
+
+
+void Gen::DepoSetRouter::build_index()
+{
+    m_cells.clear();
+    if (m_faces.empty()) {
+        log->warn("DepoSetRouter: no sensitive faces, all depos will be dropped");
+        return;
+    }
+
+    // Grid spans the union of all face volumes.  Cell size along
+    // each axis is the median face extent so most faces cover only
+    // a few cells and most cells hold only a few faces.
+    double lo[3], hi[3];
+    std::vector<double> extents[3];
+    for (size_t ind=0; ind<m_faces.size(); ++ind) {
+        auto ray = m_faces[ind].bb.bounds();
+        for (int axis=0; axis<3; ++axis) {
+            const double a = std::min(coord(ray.first, axis), coord(ray.second, axis));
+            const double b = std::max(coord(ray.first, axis), coord(ray.second, axis));
+            if (!ind) {
+                lo[axis] = a;
+                hi[axis] = b;
+            }
+            else {
+                lo[axis] = std::min(lo[axis], a);
+                hi[axis] = std::max(hi[axis], b);
+            }
+            extents[axis].push_back(b-a);
+        }
+    }
+    size_t ncells_total = 1;
+    for (int axis=0; axis<3; ++axis) {
+        auto& ext = extents[axis];
+        std::nth_element(ext.begin(), ext.begin()+ext.size()/2, ext.end());
+        const double span = hi[axis] - lo[axis];
+        double size = ext[ext.size()/2];
+        if (size <= 0 || span <= 0) {
+            size = std::max(span, 1.0*units::mm);
+        }
+        size = std::max(size, span/max_cells_per_axis);
+        m_cell_size[axis] = size;
+        m_ncells[axis] = std::max(1, (int)std::ceil(span/size));
+        ncells_total *= m_ncells[axis];
+    }
+    m_grid_origin = Point(lo[0], lo[1], lo[2]);
+    m_cells.resize(ncells_total);
+
+    for (size_t iface=0; iface<m_faces.size(); ++iface) {
+        auto ray = m_faces[iface].bb.bounds();
+        int cmin[3], cmax[3];
+        for (int axis=0; axis<3; ++axis) {
+            const double a = std::min(coord(ray.first, axis), coord(ray.second, axis));
+            const double b = std::max(coord(ray.first, axis), coord(ray.second, axis));
+            const double org = coord(m_grid_origin, axis);
+            cmin[axis] = std::min(m_ncells[axis]-1, std::max(0, (int)std::floor((a-org)/m_cell_size[axis])));
+            cmax[axis] = std::min(m_ncells[axis]-1, std::max(0, (int)std::floor((b-org)/m_cell_size[axis])));
+        }
+        for (int ix=cmin[0]; ix<=cmax[0]; ++ix) {
+            for (int iy=cmin[1]; iy<=cmax[1]; ++iy) {
+                for (int iz=cmin[2]; iz<=cmax[2]; ++iz) {
+                    m_cells[(ix*m_ncells[1] + iy)*m_ncells[2] + iz].push_back(iface);
+                }
+            }
+        }
+    }
+    log->debug("DepoSetRouter: indexed {} faces of {} anodes in {}x{}x{} cells",
+               m_faces.size(), m_anodes.size(), m_ncells[0], m_ncells[1], m_ncells[2]);
+}
+
+int Gen::DepoSetRouter::cell_index(const Point& pt) const
+{
+    if (m_cells.empty()) {
+        return -1;
+    }
+    int cind[3];
+    for (int axis=0; axis<3; ++axis) {
+        const double rel = (coord(pt, axis) - coord(m_grid_origin, axis))/m_cell_size[axis];
+        if (rel < 0 || rel > m_ncells[axis]) {
+            return -1;
+        }
+        cind[axis] = std::min(m_ncells[axis]-1, (int)rel);
+    }
+    return (cind[0]*m_ncells[1] + cind[1])*m_ncells[2] + cind[2];
+}
+
+
+std::vector<std::string> Gen::DepoSetRouter::output_types()
+{
+    const std::string tname = std::string(typeid(output_type).name());
+    std::vector<std::string> ret(m_anodes.size(), tname);
+    return ret;
+}
+
+
+bool Gen::DepoSetRouter::operator()(const input_pointer& in, output_vector& outv)
+{
+    const size_t nports = m_anodes.size();
+    outv.resize(nports);
+
+    if (!in) {
+        log->debug("DepoSetRouter fanout EOS");
+        for (size_t ind=0; ind<nports; ++ind) {
+            outv[ind] = nullptr;
+        }
+        return true;
+    }
+
+    auto depos = in->depos();
+    std::vector<IDepo::vector> routed(nports);
+    // The last depo sent to each port, to avoid sending a depo twice
+    // when it is in both faces of one anode.
+    const size_t none = depos->size();
+    std::vector<size_t> last(nports, none);
+    size_t ndropped = 0;
+
+    for (size_t idepo=0; idepo < depos->size(); ++idepo) {
+        auto depo = depos->at(idepo);
+        const auto pt = depo->pos();
+        const int icell = cell_index(pt);
+        bool used = false;
+        if (icell >= 0) {
+            for (auto iface : m_cells[icell]) {
+                const auto& fb = m_faces[iface];
+                if (last[fb.port] == idepo) {
+                    continue;
+                }
+                if (!fb.bb.inside(pt)) {
+                    continue;
+                }
+                routed[fb.port].push_back(depo);
+                last[fb.port] = idepo;
+                used = true;
+            }
+        }
+        if (!used) {
+            ++ndropped;
+        }
+    }
+
+    for (size_t ind=0; ind<nports; ++ind) {
+        outv[ind] = std::make_shared<SimpleDepoSet>(in->ident(), routed[ind]);
+    }
+    log->debug("DepoSetRouter ({}) routed {} depos to {} anodes, dropped {}",
+               in->ident(), depos->size()-ndropped, nports, ndropped);
+    return true;
+}
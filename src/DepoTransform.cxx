@@ -45,9 +45,12 @@
 #include "WireCellIface/SimpleTrace.h"
 #include "WireCellIface/SimpleFrame.h"
 #include "WireCellGen/BinnedDiffusion_transform.h"
+#include "WireCellGen/Metrics.h"
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/Point.h"
 
+#include <algorithm>
+
 WIRECELL_FACTORY(DepoTransform, WireCell::Gen::DepoTransform,
                  WireCell::IDepoFramer, WireCell::IConfigurable)
 
@@ -61,6 +64,12 @@ Gen::DepoTransform::DepoTransform()
     , m_drift_speed(1.0*units::mm/units::us)
     , m_nsigma(3.0)
     , m_frame_count(0)
+    , m_max_memory(0)
+    , m_roi_tiling(false)
+    , m_split_response(false)
+    , m_channel_basis(false)
+    , m_streaming(false)
+    , m_tail_ticks(0)
     , l(Log::logger("sim"))
 {
 }
@@ -87,6 +96,12 @@ void Gen::DepoTransform::configure(const WireCell::Configuration& cfg)
     m_start_time = get<double>(cfg, "start_time", m_start_time);
     m_drift_speed = get<double>(cfg, "drift_speed", m_drift_speed);
     m_frame_count = get<int>(cfg, "first_frame_number", m_frame_count);
+    m_max_memory = get<double>(cfg, "max_memory", (double)m_max_memory);
+    m_streaming = get<bool>(cfg, "streaming", m_streaming);
+    m_roi_tiling = get<bool>(cfg, "roi_tiling", m_roi_tiling);
+    m_split_response = get<bool>(cfg, "split_response", m_split_response);
+    m_channel_basis = get<bool>(cfg, "channel_basis", m_channel_basis);
+    m_carry.clear();
 
     auto jpirs = cfg["pirs"];
     if (jpirs.isNull() or jpirs.empty()) {
@@ -101,6 +116,28 @@ void Gen::DepoTransform::configure(const WireCell::Configuration& cfg)
         m_pirs.push_back(pir);
     }
 
+    // A Gen::AnodePlane gives the rows by its channel index.
+    m_ganode = std::dynamic_pointer_cast<const Gen::AnodePlane>(m_anode);
+    m_channel_index.clear();
+    if (m_ganode) {
+        m_channels = m_ganode->channel_idents();
+    }
+    else {
+        m_channels = m_anode->channels();
+        for (size_t ind=0; ind<m_channels.size(); ++ind) {
+            m_channel_index[m_channels[ind]] = ind;
+        }
+    }
+
+    m_tail_ticks = 0;
+    for (auto pir : m_pirs) {
+        auto ir = pir->closest(0);
+        m_tail_ticks = std::max(m_tail_ticks, ir->waveform_pad() + ir->long_aux_waveform_pad());
+    }
+    if (m_streaming) {
+        l->debug("DepoTransform: streaming with {} ticks of response tail", m_tail_ticks);
+    }
+
 }
 WireCell::Configuration Gen::DepoTransform::default_configuration() const
 {
@@ -130,6 +167,37 @@ WireCell::Configuration Gen::DepoTransform::default_configuration() const
     /// Allow for a custom starting frame number
     put(cfg, "first_frame_number", m_frame_count);
 
+    /// If positive, the number of bytes which the convolution of one
+    /// plane should try not to exceed, eg 1e9.  Large events are then
+    /// convolved in tiles.  Zero means no limit.
+    put(cfg, "max_memory", (double)m_max_memory);
+
+    /// If true, convolve only padded boxes around the occupied
+    /// regions of each plane instead of one box spanning all charge.
+    /// This saves much work for sparse events.
+    put(cfg, "roi_tiling", m_roi_tiling);
+
+    /// If true, convolve in 2D with the field response alone and
+    /// then each channel with the electronics (short) responses.
+    /// The 2D transforms are then shorter in time.  This requires
+    /// the "PlaneImpactResponse" component and is otherwise ignored.
+    put(cfg, "split_response", m_split_response);
+
+    /// If true, sum the waveforms of all wires of a channel, eg the
+    /// wrapped wire segments on both faces of an APA, as they are
+    /// made and output one trace per channel.  Otherwise one trace
+    /// per wire is output.  Streaming mode implies this.
+    put(cfg, "channel_basis", m_channel_basis);
+
+    /// If true, treat successive depo sets as successive, contiguous
+    /// readouts of a long continuous stream.  Each readout then
+    /// starts where the previous one ended, depos must arrive in time
+    /// order and the response which extends past the end of one
+    /// readout is carried into the next.  Depos earlier than the
+    /// start of the readout are dropped and counted.  One trace per
+    /// channel is made.  Any tail pending at EOS is dropped.
+    put(cfg, "streaming", m_streaming);
+
     /// Name of component providing the anode plane.
     put(cfg, "anode", "");
     /// Name of component providing the anode pseudo random number generator.
@@ -142,21 +210,75 @@ WireCell::Configuration Gen::DepoTransform::default_configuration() const
     return cfg;
 }
 
+size_t Gen::DepoTransform::channel_row(int chid)
+{
+    if (m_ganode) {
+        const int ind = m_ganode->channel_index(chid);
+        if (ind >= 0) {
+            return ind;
+        }
+    }
+    auto it = m_channel_index.find(chid);
+    if (it != m_channel_index.end()) {
+        return it->second;
+    }
+    // A wire of a channel which the anode does not list.
+    const size_t ind = m_channels.size();
+    m_channels.push_back(chid);
+    m_channel_index[chid] = ind;
+    return ind;
+}
+
 bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out)
 {
     if (!in) {
+        if (m_carry.size()) {
+            l->debug("DepoTransform: dropping response tails of {} channels at EOS",
+                     m_carry.size());
+            m_carry.clear();
+        }
         out = nullptr;
         return true;
     }
 
+    MetricsTimer timer("DepoTransform");
+    auto& metrics = Metrics::instance();
+
     auto depos = in->depos();
+    metrics.count("DepoTransform", "depos_in", depos->size());
+    if (m_streaming) {
+        // Depos must arrive in time order.  Any earlier than this
+        // readout missed the one they belong to and are dropped.
+        auto ontime = make_shared<IDepo::vector>();
+        for (auto depo : *depos) {
+            if (depo->time() >= m_start_time) {
+                ontime->push_back(depo);
+            }
+        }
+        const size_t nearly = depos->size() - ontime->size();
+        if (nearly) {
+            metrics.count("DepoTransform", "depos_early", nearly);
+            l->warn("DepoTransform: dropping {} depos earlier than the readout start at {} ms",
+                    nearly, m_start_time/units::ms);
+            depos = ontime;
+        }
+    }
 
     Binning tbins(m_readout_time/m_tick, m_start_time, m_start_time+m_readout_time);
     ITrace::vector traces;
+
+    // In streaming mode the sampling extends past the readout by the
+    // response tail and waveforms are summed by channel.
+    const int nticks = tbins.nbins();
+    const int ntail = m_streaming ? m_tail_ticks : 0;
+    const bool by_channel = m_channel_basis || m_streaming;
+    // Rows are allocated on first use.
+    std::vector<Waveform::realseq_t> chrows(by_channel ? m_channels.size() : 0);
     for (auto face : m_anode->faces()) {
 
         // Select the depos which are in this face's sensitive volume
-        IDepo::vector face_depos, dropped_depos;
+        IDepo::vector face_depos;
+        size_t ndropped = 0;
         auto bb = face->sensitive();
         if (bb.empty()) {
             l->debug("anode {} face {} is marked insensitive, skipping",
@@ -169,7 +291,7 @@ bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out
                 face_depos.push_back(depo);
             }
             else {
-                dropped_depos.push_back(depo);
+                ++ndropped;
             }
         }
 
@@ -182,16 +304,13 @@ bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out
                      face_depos.back()->time()/units::ms,
                      ray.first/units::cm,ray.second/units::cm);
         }
-        if (dropped_depos.size()) {
+        metrics.count("DepoTransform", "depos_dropped", ndropped);
+        if (ndropped) {
             auto ray = bb.bounds();
-            l->debug("anode: {}, face: {}, dropped {} depos spanning "
-                     "t:[{},{}]ms, outside bb:[{}-->{}]cm",
-                     m_anode->ident(), face->ident(),
-                     dropped_depos.size(),
-                     dropped_depos.front()->time()/units::ms,
-                     dropped_depos.back()->time()/units::ms,
+            l->debug("anode: {}, face: {}, dropped {} depos "
+                     "outside bb:[{}-->{}]cm",
+                     m_anode->ident(), face->ident(), ndropped,
                      ray.first/units::cm, ray.second/units::cm);
-
         }
 
         int iplane = -1;
@@ -200,22 +319,42 @@ bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out
 
             const Pimpos* pimpos = plane->pimpos();
 
-            Binning tbins(m_readout_time/m_tick, m_start_time,
-                          m_start_time+m_readout_time);
+            const double tmax = ntail ? m_start_time+(nticks+ntail)*m_tick
+                                      : m_start_time+m_readout_time;
+            Binning tbins(nticks+ntail, m_start_time, tmax);
 
             Gen::BinnedDiffusion_transform bindiff(*pimpos, tbins, m_nsigma, m_rng);
             for (auto depo : face_depos) {
                 depo = modify_depo(plane->planeid(), depo);
                 bindiff.add(depo, depo->extent_long() / m_drift_speed, depo->extent_tran());
             }
+            metrics.count("DepoTransform", "outside_pitch", bindiff.outside_pitch());
+            metrics.count("DepoTransform", "outside_time", bindiff.outside_time());
 
             auto& wires = plane->wires();
 
             auto pir = m_pirs.at(iplane);
-            Gen::ImpactTransform transform(pir, bindiff);
+            Gen::ImpactTransform transform(pir, bindiff, m_max_memory, m_roi_tiling, m_split_response);
 
             const int nwires = pimpos->region_binning().nbins();
             for (int iwire=0; iwire<nwires; ++iwire) {
+                int chid = wires[iwire]->channel();
+                if (by_channel) {
+                    if (!transform.covers(iwire)) {
+                        continue;
+                    }
+                    const size_t row = channel_row(chid);
+                    if (row >= chrows.size()) {
+                        chrows.resize(row+1);
+                    }
+                    auto& chwave = chrows[row];
+                    if (chwave.empty()) {
+                        chwave.resize(nticks+ntail, 0.0);
+                    }
+                    transform.add_waveform(iwire, chwave);
+                    continue;
+                }
+
                 auto wave = transform.waveform(iwire);
                 
                 auto mm = Waveform::edge(wave);
@@ -223,7 +362,6 @@ bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out
                     continue;
                 }
                 
-                int chid = wires[iwire]->channel();
                 int tbin = mm.first;
 
                 ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
@@ -233,8 +371,56 @@ bool Gen::DepoTransform::operator()(const input_pointer& in, output_pointer& out
         }
     }
 
+    if (m_streaming) {
+        // Add the tails carried from the previous readout, carry on
+        // the new tails and cut to the readout.
+        for (auto& it : m_carry) {
+            const size_t row = channel_row(it.first);
+            if (row >= chrows.size()) {
+                chrows.resize(row+1);
+            }
+            auto& chwave = chrows[row];
+            if (chwave.empty()) {
+                chwave.resize(nticks+ntail, 0.0);
+            }
+            const auto& tail = it.second;
+            for (size_t ind=0; ind<tail.size(); ++ind) {
+                chwave[ind] += tail[ind];
+            }
+        }
+        m_carry.clear();
+        for (size_t row=0; row<chrows.size(); ++row) {
+            auto& chwave = chrows[row];
+            if (chwave.empty()) {
+                continue;
+            }
+            Waveform::realseq_t tail(chwave.begin()+nticks, chwave.end());
+            if (Waveform::edge(tail).first < (int)tail.size()) {
+                m_carry[m_channels[row]] = tail;
+            }
+            chwave.resize(nticks);
+        }
+        metrics.peak("DepoTransform", "carried_channels", m_carry.size());
+    }
+    for (size_t row=0; row<chrows.size(); ++row) {
+        const auto& chwave = chrows[row];
+        if (chwave.empty()) {
+            continue;
+        }
+        auto mm = Waveform::edge(chwave);
+        if (mm.first == (int)chwave.size()) { // all zero
+            continue;
+        }
+        ITrace::ChargeSequence charge(chwave.begin()+mm.first, chwave.begin()+mm.second);
+        traces.push_back(make_shared<SimpleTrace>(m_channels[row], mm.first, charge));
+    }
+
+    metrics.count("DepoTransform", "traces_out", traces.size());
     auto frame = make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
     ++m_frame_count;
+    if (m_streaming) {
+        m_start_time += m_readout_time;
+    }
     out = frame;
     return true;
 }
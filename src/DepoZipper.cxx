@@ -1,4 +1,5 @@
 #include "WireCellGen/DepoZipper.h"
+#include "WireCellGen/Metrics.h"
 #include "WireCellGen/ImpactZipper.h"
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellIface/IAnodePlane.h"
@@ -22,6 +23,8 @@ Gen::DepoZipper::DepoZipper()
     , m_drift_speed(1.0*units::mm/units::us)
     , m_nsigma(3.0)
     , m_frame_count(0)
+    , m_nthreads(1)
+    , m_nshards(0)
 {
 }
 
@@ -47,6 +50,8 @@ void Gen::DepoZipper::configure(const WireCell::Configuration& cfg)
     m_start_time = get<double>(cfg, "start_time", m_start_time);
     m_drift_speed = get<double>(cfg, "drift_speed", m_drift_speed);
     m_frame_count = get<int>(cfg, "first_frame_number", m_frame_count);
+    m_nthreads = get<int>(cfg, "nthreads", m_nthreads);
+    m_nshards = get<int>(cfg, "nshards", m_nshards);
 
     auto jpirs = cfg["pirs"];
     if (jpirs.isNull() or jpirs.empty()) {
@@ -88,6 +93,15 @@ WireCell::Configuration Gen::DepoZipper::default_configuration() const
     /// Allow for a custom starting frame number
     put(cfg, "first_frame_number", m_frame_count);
 
+    /// Number of threads used to zip each wire plane.  If more
+    /// than one, the plane's wires are split into shards which are
+    /// zipped concurrently.  The result does not depend on this.
+    put(cfg, "nthreads", m_nthreads);
+
+    /// Number of wire shards per plane when nthreads is more than
+    /// one.  Zero means four shards per thread.
+    put(cfg, "nshards", m_nshards);
+
     /// Name of component providing the anode plane.
     put(cfg, "anode", "");
     /// Name of component providing the anode pseudo random number generator.
@@ -107,6 +121,7 @@ bool Gen::DepoZipper::operator()(const input_pointer& in, output_pointer& out)
         cerr << "Gen::DepoZipper: EOS\n";
         return true;
     }
+    MetricsTimer timer("DepoZipper");
 
     auto depos = in->depos();
 
@@ -164,29 +179,10 @@ bool Gen::DepoZipper::operator()(const input_pointer& in, output_pointer& out)
                 bindiff.add(depo, depo->extent_long() / m_drift_speed, depo->extent_tran());
             }
 
-            auto& wires = plane->wires();
-
             auto pir = m_pirs.at(iplane);
-            Gen::ImpactZipper zipper(pir, bindiff);
-
-            const int nwires = pimpos->region_binning().nbins();
-            for (int iwire=0; iwire<nwires; ++iwire) {
-                auto wave = zipper.waveform(iwire);
-                
-                auto mm = Waveform::edge(wave);
-                if (mm.first == (int)wave.size()) { // all zero
-                    continue;
-                }
-                
-                int chid = wires[iwire]->channel();
-                int tbin = mm.first;
-
-                //std::cout << mm.first << " "<< mm.second << std::endl;
-		
-                ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
-                auto trace = make_shared<SimpleTrace>(chid, tbin, charge);
-                traces.push_back(trace);
-            }
+            auto newtraces = Gen::zip_plane(pir, bindiff, plane->wires(),
+                                            m_nthreads, m_nshards);
+            traces.insert(traces.end(), newtraces.begin(), newtraces.end());
         }
     }
 
@@ -1,4 +1,5 @@
 #include "WireCellGen/Digitizer.h"
+#include "WireCellGen/Metrics.h"
 
 #include "WireCellIface/IWireSelectors.h"
 #include "WireCellIface/SimpleFrame.h"
@@ -101,7 +102,7 @@ bool Gen::Digitizer::operator()(const input_pointer& vframe, output_pointer& adc
         adcframe = nullptr;
         return true;
     }
-
+    MetricsTimer timer("Digitizer");
 
     // fixme: maybe make this honor a tag 
     auto vtraces = FrameTools::untagged_traces(vframe);
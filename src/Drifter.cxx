@@ -1,4 +1,5 @@
 #include "WireCellGen/Drifter.h"
+#include "WireCellGen/Metrics.h"
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/String.h"
@@ -10,6 +11,8 @@
 
 #include <boost/range.hpp>
 
+#include <algorithm>
+#include <limits>
 #include <sstream>
 
 WIRECELL_FACTORY(Drifter, WireCell::Gen::Drifter,
@@ -36,6 +39,10 @@ Gen::Drifter::Xregion::Xregion(Configuration cfg)
     : anode(0.0)
     , response(0.0)
     , cathode(0.0)
+    , ymin(-std::numeric_limits<double>::infinity())
+    , ymax(+std::numeric_limits<double>::infinity())
+    , zmin(-std::numeric_limits<double>::infinity())
+    , zmax(+std::numeric_limits<double>::infinity())
 {
     auto ja = cfg["anode"];
     auto jr = cfg["response"];
@@ -45,6 +52,10 @@ Gen::Drifter::Xregion::Xregion(Configuration cfg)
     anode = ja.asDouble();
     response = jr.asDouble();
     cathode = jc.asDouble();
+    ymin = get<double>(cfg, "ymin", ymin);
+    ymax = get<double>(cfg, "ymax", ymax);
+    zmin = get<double>(cfg, "zmin", zmin);
+    zmax = get<double>(cfg, "zmax", zmax);
 }
 bool Gen::Drifter::Xregion::inside_response(double x) const
 {
@@ -54,6 +65,52 @@ bool Gen::Drifter::Xregion::inside_bulk(double x) const
 {
     return (response < x and x < cathode) or (cathode < x and x < response);
 }
+bool Gen::Drifter::Xregion::inside_transverse(const Point& pt) const
+{
+    return ymin <= pt.y() and pt.y() <= ymax and zmin <= pt.z() and pt.z() <= zmax;
+}
+
+
+// XIndex helper
+
+void Gen::Drifter::XIndex::build(const std::vector< std::pair<double,double> >& intervals)
+{
+    edges.clear();
+    candidates.clear();
+    for (const auto& iv : intervals) {
+        edges.push_back(iv.first);
+        edges.push_back(iv.second);
+    }
+    std::sort(edges.begin(), edges.end());
+    edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    if (edges.size() < 2) {
+        edges.clear();
+        return;
+    }
+    candidates.resize(edges.size()-1);
+    for (size_t ind=0; ind<intervals.size(); ++ind) {
+        const auto& iv = intervals[ind];
+        if (iv.first == iv.second) {
+            continue;           // empty open interval
+        }
+        auto beg = std::lower_bound(edges.begin(), edges.end(), iv.first) - edges.begin();
+        auto end = std::lower_bound(edges.begin(), edges.end(), iv.second) - edges.begin();
+        for (auto iseg = beg; iseg < end; ++iseg) {
+            candidates[iseg].push_back(ind);
+        }
+    }
+}
+
+const std::vector<size_t>* Gen::Drifter::XIndex::find(double x) const
+{
+    if (edges.empty() or x < edges.front() or x >= edges.back()) {
+        return nullptr;
+    }
+    // An x exactly on an edge can only be inside an open interval
+    // which also covers the segment to its right.
+    const size_t iseg = std::upper_bound(edges.begin(), edges.end(), x) - edges.begin() - 1;
+    return &candidates[iseg];
+}
 
 
 Gen::Drifter::Drifter()
@@ -112,6 +169,7 @@ void Gen::Drifter::configure(const WireCell::Configuration& cfg)
     for (auto jone : jxregions) {
         m_xregions.push_back(Xregion(jone));
     }
+    build_index();
     l->debug("Drifter: time offset: {} ms, drift speed: {} mm/us",
             m_toffset/units::ms, m_speed/(units::mm/units::us));
 }
@@ -119,6 +177,20 @@ void Gen::Drifter::configure(const WireCell::Configuration& cfg)
 void Gen::Drifter::reset()
 {
     m_xregions.clear();
+    build_index();
+}
+
+void Gen::Drifter::build_index()
+{
+    std::vector< std::pair<double,double> > resp, bulk;
+    for (const auto& xr : m_xregions) {
+        resp.push_back(std::make_pair(std::min(xr.anode, xr.response),
+                                      std::max(xr.anode, xr.response)));
+        bulk.push_back(std::make_pair(std::min(xr.response, xr.cathode),
+                                      std::max(xr.response, xr.cathode)));
+    }
+    m_resp_index.build(resp);
+    m_bulk_index.build(bulk);
 }
 
 
@@ -131,34 +203,46 @@ bool Gen::Drifter::insert(const input_pointer& depo)
         return false;
     }
 
-    // Find which X region to add, or reject.  Maybe there is a faster
-    // way to do this than a loop.  For example, the regions could be
-    // examined in order to find some regular binning of the X axis
-    // and then at worse only explicitly check extent partial bins
-    // near to their edges.
-
-
-
+    // Find which X region to add, or reject.
+    const Point& dpos = depo->pos();
+    const double x = dpos.x();
+    Xregion* xreg = nullptr;
     double respx = 0, direction = 0.0;
 
-    auto xrit = std::find_if(m_xregions.begin(), m_xregions.end(), 
-                             Gen::Drifter::IsInsideResp(depo));
-    if (xrit != m_xregions.end()) {
+    auto cands = m_resp_index.find(x);
+    if (cands) {
+        for (auto ind : *cands) {
+            auto& xr = m_xregions[ind];
+            if (xr.inside_response(x) and xr.inside_transverse(dpos)) {
+                xreg = &xr;
+                break;
+            }
+        }
+    }
+    if (xreg) {
         // Back up in space and time.  This is a best effort fudge.  See:
         // https://github.com/WireCell/wire-cell-gen/issues/22
 
-        respx = xrit->response;
+        respx = xreg->response;
         direction = -1.0;
     }
     else {
-        xrit = std::find_if(m_xregions.begin(), m_xregions.end(), 
-                            Gen::Drifter::IsInsideBulk(depo));
-        if (xrit != m_xregions.end()) { // in bulk
-            respx = xrit->response;
+        cands = m_bulk_index.find(x);
+        if (cands) {
+            for (auto ind : *cands) {
+                auto& xr = m_xregions[ind];
+                if (xr.inside_bulk(x) and xr.inside_transverse(dpos)) {
+                    xreg = &xr;
+                    break;
+                }
+            }
+        }
+        if (xreg) {             // in bulk
+            respx = xreg->response;
             direction = 1.0;
         }
     }
-    if (xrit == m_xregions.end()) {
+    if (!xreg) {
         return false;           // outside both regions
     }
 
@@ -193,7 +277,7 @@ bool Gen::Drifter::insert(const input_pointer& depo)
     }
 
     auto newdepo = make_shared<SimpleDepo>(depo->time() + direction*dt + m_toffset, pos, Qf, depo, dL, dT);
-    xrit->depos.insert(newdepo);
+    xreg->depos.insert(newdepo);
     return true;
 }    
 
@@ -260,6 +344,10 @@ bool Gen::Drifter::operator()(const input_pointer& depo, output_queue& outq)
 
         flush(outq);
 
+        auto& metrics = Metrics::instance();
+        metrics.count("Drifter", "depos_in", n_dropped+n_drifted);
+        metrics.count("Drifter", "depos_out", n_drifted);
+        metrics.count("Drifter", "depos_dropped", n_dropped);
         if (n_dropped) {
             l->debug("at EOS, dropped {} / {} depos from stream, outside of all {} drift regions", n_dropped, n_dropped+n_drifted, m_xregions.size());
         }
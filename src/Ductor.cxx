@@ -1,6 +1,7 @@
 #include "WireCellGen/Ductor.h"
 #include "WireCellGen/BinnedDiffusion.h"
 #include "WireCellGen/ImpactZipper.h"
+#include "WireCellGen/Metrics.h"
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/Point.h"
 #include "WireCellUtil/NamedFactory.h"
@@ -27,6 +28,8 @@ Gen::Ductor::Ductor()
     , m_fluctuate(true)
     , m_mode("continuous")
     , m_frame_count(0)
+    , m_nthreads(1)
+    , m_nshards(0)
     , l(Log::logger("sim"))
 {
 }
@@ -68,6 +71,15 @@ WireCell::Configuration Gen::Ductor::default_configuration() const
     /// Allow for a custom starting frame number
     put(cfg, "first_frame_number", m_frame_count);
 
+    /// Number of threads used to zip each wire plane.  If more
+    /// than one, the plane's wires are split into shards which are
+    /// zipped concurrently.  The result does not depend on this.
+    put(cfg, "nthreads", m_nthreads);
+
+    /// Number of wire shards per plane when nthreads is more than
+    /// one.  Zero means four shards per thread.
+    put(cfg, "nshards", m_nshards);
+
     /// Name of component providing the anode plane.
     put(cfg, "anode", m_anode_tn);
     put(cfg, "rng", m_rng_tn);
@@ -110,6 +122,8 @@ void Gen::Ductor::configure(const WireCell::Configuration& cfg)
     m_start_time = get<double>(cfg, "start_time", m_start_time);
     m_drift_speed = get<double>(cfg, "drift_speed", m_drift_speed);
     m_frame_count = get<int>(cfg, "first_frame_number", m_frame_count);
+    m_nthreads = get<int>(cfg, "nthreads", m_nthreads);
+    m_nshards = get<int>(cfg, "nshards", m_nshards);
 
     auto jpirs = cfg["pirs"];
     if (jpirs.isNull() or jpirs.empty()) {
@@ -146,33 +160,20 @@ ITrace::vector Gen::Ductor::process_face(IAnodeFace::pointer face,
             bindiff.add(depo, depo->extent_long() / m_drift_speed, depo->extent_tran());
         }
 
-        auto& wires = plane->wires();
-
         auto pir = m_pirs.at(iplane);
-        Gen::ImpactZipper zipper(pir, bindiff);
-
-        const int nwires = pimpos->region_binning().nbins();
-        for (int iwire=0; iwire<nwires; ++iwire) {
-            auto wave = zipper.waveform(iwire);
-                
-            auto mm = Waveform::edge(wave);
-            if (mm.first == (int)wave.size()) { // all zero
-                continue;
-            }
-                
-            int chid = wires[iwire]->channel();
-            int tbin = mm.first;
-
-            ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
-            auto trace = make_shared<SimpleTrace>(chid, tbin, charge);
-            traces.push_back(trace);
-        }
+        auto newtraces = Gen::zip_plane(pir, bindiff, plane->wires(),
+                                        m_nthreads, m_nshards);
+        traces.insert(traces.end(), newtraces.begin(), newtraces.end());
     }
     return traces;
 }
 
 void Gen::Ductor::process(output_queue& frames)
 {
+    MetricsTimer timer("Ductor");
+    auto& metrics = Metrics::instance();
+    metrics.count("Ductor", "depos_in", m_depos.size());
+
     ITrace::vector traces;
 
     for (auto face : m_anode->faces()) {
@@ -216,10 +217,13 @@ void Gen::Ductor::process(output_queue& frames)
 
         }
 
+        metrics.count("Ductor", "depos_dropped", dropped_depos.size());
+
         auto newtraces = process_face(face, face_depos);
         traces.insert(traces.end(), newtraces.begin(), newtraces.end());
     }
 
+    metrics.count("Ductor", "traces_out", traces.size());
     auto frame = make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
     frames.push_back(frame);
     l->debug("made frame: {} with {} traces @ {}ms",
@@ -151,6 +151,8 @@ void Gen::EmpiricalNoiseModel::configure(const WireCell::Configuration& cfg)
 {
     m_anode_tn = get(cfg, "anode", m_anode_tn);
     m_anode = Factory::find_tn<IAnodePlane>(m_anode_tn);
+    m_ganode = std::dynamic_pointer_cast<const Gen::AnodePlane>(m_anode);
+    m_chid_to_intlen.clear();
 
     m_chanstat_tn = get(cfg, "chanstat", m_chanstat_tn);
     if (m_chanstat_tn != "") {	// allow for an empty channel status, no deviation from norm
@@ -296,27 +298,32 @@ const IChannelSpectrum::amplitude_t& Gen::EmpiricalNoiseModel::operator()(int ch
 {
     // get truncated wire length for cache
     int ilen=0;
-    auto chlen = m_chid_to_intlen.find(chid);
-    if (chlen == m_chid_to_intlen.end()) {  // new channel
-        auto wires =  m_anode->wires(chid); // sum up wire length
-        double len = 0.0;
-        for (auto wire : wires) {
-            len += ray_length(wire->ray());
-        }
-	// cache every cm ...
-	ilen = int(len/m_wlres);
-        // there might be  aproblem with the wire length's unit
-	//ilen = int(len);
-        m_chid_to_intlen[chid] = ilen;
+    const int chind = m_ganode ? m_ganode->channel_index(chid) : -1;
+    if (chind >= 0) {
+        ilen = int(m_ganode->channel_wire_lengths()[chind]/m_wlres);
     }
     else {
-        ilen = chlen->second;
+        auto chlen = m_chid_to_intlen.find(chid);
+        if (chlen == m_chid_to_intlen.end()) {  // new channel
+            auto wires =  m_anode->wires(chid); // sum up wire length
+            double len = 0.0;
+            for (auto wire : wires) {
+                len += ray_length(wire->ray());
+            }
+            // cache every cm ...
+            ilen = int(len/m_wlres);
+            // there might be  aproblem with the wire length's unit
+            //ilen = int(len);
+            m_chid_to_intlen[chid] = ilen;
+        }
+        else {
+            ilen = chlen->second;
+        }
     }
 
 
     // saved content
-    auto wpid = m_anode->resolve(chid);
-    const int iplane = wpid.index();
+    const int iplane = chind >= 0 ? m_ganode->channel_planes()[chind] : m_anode->resolve(chid).index();
 
     auto& amp_cache = m_amp_cache.at(iplane);
     auto lenamp = amp_cache.find(ilen);
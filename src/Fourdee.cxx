@@ -3,8 +3,17 @@
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/ConfigManager.h"
 #include "WireCellUtil/ExecMon.h"
+#include "WireCellUtil/Exceptions.h"
 
 #include "WireCellGen/GenPipeline.h"
+#include "WireCellGen/AddNoise.h"
+#include "WireCellGen/BlipSource.h"
+#include "WireCellGen/Drifter.h"
+#include "WireCellGen/Ductor.h"
+#include "WireCellGen/MultiDuctor.h"
+#include "WireCellGen/NoiseSource.h"
+
+#include <map>
 
 WIRECELL_FACTORY(FourDee, WireCell::Gen::Fourdee,
                  WireCell::IApplication, WireCell::IConfigurable)
@@ -20,6 +29,8 @@ Gen::Fourdee::Fourdee()
     , m_dissonance(nullptr)
     , m_digitizer(nullptr)
     , m_output(nullptr)
+    , m_executor("serial")
+    , m_queue_capacity(64)
 {
 }
 
@@ -41,10 +52,84 @@ WireCell::Configuration Gen::Fourdee::default_configuration() const
     put(cfg, "Filter", "");  
     put(cfg, "FrameSink", "DumpFrames"); 
 
+    // How to execute the pipeline.  "serial" runs all stages in one
+    // thread.  "threaded" runs each stage in its own thread so that,
+    // eg, noise and digitization of one frame overlap with the
+    // simulation of the next.  Stages must then not share any
+    // component which is not thread safe such as an IRandom.  Stages
+    // of known types which share one are rejected at configuration.
+    put(cfg, "executor", m_executor);
+
+    // In "threaded" mode, the number of elements (depos or frames)
+    // which may wait between two stages before the upstream stage
+    // blocks.  It is rounded up to a power of two.
+    put(cfg, "queue_capacity", (int)m_queue_capacity);
+
     return cfg;
 }
 
 
+// The random number generators of a pipeline stage, as far as its type
+// is known here.
+template<typename NodePointer>
+static
+std::vector<IRandom::pointer> stage_rngs(NodePointer node)
+{
+    std::vector<IRandom::pointer> ret;
+    if (!node) {
+        return ret;
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::BlipSource>(node)) {
+        ret.push_back(gen->rng());
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::Drifter>(node)) {
+        ret.push_back(gen->rng());
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::Ductor>(node)) {
+        ret.push_back(gen->rng());
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::MultiDuctor>(node)) {
+        auto rngs = gen->rngs();
+        ret.insert(ret.end(), rngs.begin(), rngs.end());
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::NoiseSource>(node)) {
+        ret.push_back(gen->rng());
+    }
+    if (auto gen = std::dynamic_pointer_cast<Gen::AddNoise>(node)) {
+        ret.push_back(gen->rng());
+    }
+    return ret;
+}
+
+void Gen::Fourdee::check_rngs() const
+{
+    const std::vector< std::pair<std::string, std::vector<IRandom::pointer> > > stages{
+        {"DepoSource", stage_rngs(m_depos)},
+        {"Drifter", stage_rngs(m_drifter)},
+        {"Ductor", stage_rngs(m_ductor)},
+        {"Dissonance", stage_rngs(m_dissonance)},
+        {"Digitizer", stage_rngs(m_digitizer)},
+        {"Filter", stage_rngs(m_filter)},
+    };
+    std::map<IRandom::pointer, std::string> users;
+    for (const auto& stage : stages) {
+        for (auto rng : stage.second) {
+            if (!rng) {
+                continue;
+            }
+            auto it = users.find(rng);
+            if (it == users.end()) {
+                users[rng] = stage.first;
+                continue;
+            }
+            if (it->second != stage.first) {
+                THROW(ValueError() << errmsg{"Gen::Fourdee: " + it->second + " and " + stage.first
+                            + " share an IRandom which is not thread safe, give each its own for the threaded executor"});
+            }
+        }
+    }
+}
+
 void Gen::Fourdee::configure(const Configuration& thecfg)
 {
     std::string tn="";
@@ -114,6 +199,16 @@ void Gen::Fourdee::configure(const Configuration& thecfg)
         m_output = Factory::find_maybe_tn<IFrameSink>(tn);
         cerr << "\tSink: " << tn << endl;
     }
+
+    m_executor = get<string>(cfg, "executor", m_executor);
+    if (m_executor != "serial" and m_executor != "threaded") {
+        THROW(ValueError() << errmsg{"Gen::Fourdee: unknown executor: " + m_executor});
+    }
+    m_queue_capacity = get<int>(cfg, "queue_capacity", (int)m_queue_capacity);
+    cerr << "\tExecutor: " << m_executor << endl;
+    if (m_executor == "threaded") {
+        check_rngs();
+    }
 }
 
 
@@ -210,54 +305,59 @@ void dump(DEPOS& depos)
 
 // Implementation warning: this violates node and proc generality in
 // order to coerce a join into a linear pipeline.
-class NoiseAdderProc : public FilterProc {
+class NoiseAdderProc : public Proc {
 public:
-    NoiseAdderProc(IFrameSource::pointer nn) : noise_node(nn) {}
+    NoiseAdderProc(IFrameSource::pointer nn, FramePipe& iq, FramePipe& oq)
+        : noise_node(nn), iq(iq), oq(oq) {}
     virtual ~NoiseAdderProc() {}
 
-    virtual Pipe& input_pipe() {
-        return iq; 
-    }
-    virtual Pipe& output_pipe() {
-        return oq; 
-    }
-
     virtual bool operator()() {
-        if (iq.empty()) { return false; }
-
-        const IFrame::pointer iframe = boost::any_cast<const IFrame::pointer>(iq.front());
-        iq.pop();
+        IFrame::pointer iframe;
+        if (!iq.pop(iframe)) { return false; }
 
         if (!iframe) {          // eos
             std::cerr << "NoiseAdderProc eos\n";
-            boost::any out = iframe;
-            oq.push(out);
-            return true;
+            return oq.push(iframe);
         }
 
         IFrame::pointer nframe;
         bool ok = (*noise_node)(nframe);
-        if (!ok) return false;
+        if (!ok) return fail();
         nframe = Gen::sum(IFrame::vector{iframe,nframe}, iframe->ident());
-        boost::any anyout = nframe;
-        oq.push(anyout);
-        return true;        
+        return oq.push(nframe);
     }
+    virtual bool input_ready() const { return !iq.empty(); }
+    virtual void close_input() { iq.close(); }
+    virtual void close_output() { oq.close(); }
 
 private:
-    Pipe iq, oq;
     IFrameSource::pointer noise_node;
-
+    FramePipe& iq;
+    FramePipe& oq;
 };
 
 
 void Gen::Fourdee::execute()
 {
+    if (m_executor == "threaded") {
+        execute_threaded();
+        return;
+    }
     execute_new();
     //execute_old();
 }
 
+void Gen::Fourdee::execute_threaded()
+{
+    execute_chain(true);
+}
+
 void Gen::Fourdee::execute_new()
+{
+    execute_chain(false);
+}
+
+void Gen::Fourdee::execute_chain(bool threaded)
 {
     if (!m_depos) {
         cerr << "Fourdee: no depos, can't do much" << endl;
@@ -269,94 +369,88 @@ void Gen::Fourdee::execute_new()
         return;
     }
 
-    Pipeline pipeline;
-    auto source = new SourceNodeProc(m_depos);
-    Proc* last_proc = source;
+    // The pipes are owned here and the procs refer to them.  Run in
+    // one thread, a proc may push more than a pipe holds so they grow.
+    std::vector< std::unique_ptr<DepoPipe> > depo_pipes;
+    std::vector< std::unique_ptr<FramePipe> > frame_pipes;
+    std::vector< std::unique_ptr<Proc> > procs;
+    auto new_depo_pipe = [&]() -> DepoPipe& {
+        depo_pipes.emplace_back(new DepoPipe(m_queue_capacity, !threaded));
+        return *depo_pipes.back();
+    };
+    auto new_frame_pipe = [&]() -> FramePipe& {
+        frame_pipes.emplace_back(new FramePipe(m_queue_capacity, !threaded));
+        return *frame_pipes.back();
+    };
+
+    DepoPipe* dpipe = &new_depo_pipe();
+    procs.emplace_back(new SourceNodeProc<IDepoSource>(m_depos, *dpipe));
 
     if (m_drifter) {            // depo in, depo out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_drifter) << endl;
-        auto proc = new QueuedNodeProc(m_drifter);
-        last_proc = join(pipeline, last_proc, proc);
+        cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_drifter) << endl;
+        DepoPipe* next = &new_depo_pipe();
+        procs.emplace_back(new QueuedNodeProc<IDrifter>(m_drifter, *dpipe, *next));
+        dpipe = next;
     }
     if (m_depofilter) {         // depo in, depo out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_depofilter) << endl;
-        auto proc = new FunctionNodeProc(m_depofilter);
-        last_proc = join(pipeline, last_proc, proc);
-    }
-
-    if (m_ductor) {             // depo in, zero or more frames out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_ductor) << endl;
-        auto proc = new QueuedNodeProc(m_ductor);
-        last_proc = join(pipeline, last_proc, proc);
-    }
-
-    if (m_dissonance) {         // frame in, frame out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_dissonance) << endl;
-        auto proc = new NoiseAdderProc(m_dissonance);
-        last_proc = join(pipeline, last_proc, proc);
-    }
-
-    if (m_digitizer) {          // frame in, frame out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_digitizer) << endl;
-        auto proc = new FunctionNodeProc(m_digitizer);
-        last_proc = join(pipeline, last_proc, proc);
+        cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_depofilter) << endl;
+        DepoPipe* next = &new_depo_pipe();
+        procs.emplace_back(new FunctionNodeProc<IDepoFilter>(m_depofilter, *dpipe, *next));
+        dpipe = next;
+    }
+
+    if (!m_ductor) {
+        cerr << "Pipeline adding #"<<procs.size()<<": sink\n";
+        procs.emplace_back(new DropSinkProc<IDepo::pointer>(*dpipe));
+    }
+    else {                      // depo in, zero or more frames out
+        cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_ductor) << endl;
+        FramePipe* fpipe = &new_frame_pipe();
+        procs.emplace_back(new QueuedNodeProc<IDuctor>(m_ductor, *dpipe, *fpipe));
+
+        if (m_dissonance) {     // frame in, frame out
+            cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_dissonance) << endl;
+            FramePipe* next = &new_frame_pipe();
+            procs.emplace_back(new NoiseAdderProc(m_dissonance, *fpipe, *next));
+            fpipe = next;
+        }
+        if (m_digitizer) {      // frame in, frame out
+            cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_digitizer) << endl;
+            FramePipe* next = &new_frame_pipe();
+            procs.emplace_back(new FunctionNodeProc<IFrameFilter>(m_digitizer, *fpipe, *next));
+            fpipe = next;
+        }
+        if (m_filter) {         // frame in, frame out
+            cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_filter) << endl;
+            FramePipe* next = &new_frame_pipe();
+            procs.emplace_back(new FunctionNodeProc<IFrameFilter>(m_filter, *fpipe, *next));
+            fpipe = next;
+        }
+        if (m_output) {         // frame in, full stop.
+            cerr << "Pipeline adding #"<<procs.size()<<": " << type(*m_output) << endl;
+            procs.emplace_back(new SinkNodeProc<IFrameSink>(m_output, *fpipe));
+        }
+        else {
+            cerr << "Pipeline adding #"<<procs.size()<<": sink\n";
+            procs.emplace_back(new DropSinkProc<IFrame::pointer>(*fpipe));
+        }
     }
 
-    if (m_filter) {          // frame in, frame out
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_filter) << endl;
-        auto proc = new FunctionNodeProc(m_filter);
-        last_proc = join(pipeline, last_proc, proc);
+    std::vector<Proc*> chain;
+    for (auto& proc : procs) {
+        chain.push_back(proc.get());
     }
-
-    if (m_output) {             // frame in, full stop.
-        cerr << "Pipeline adding #"<<pipeline.size()<<": " << type(*m_output) << endl;
-        auto proc = new SinkNodeProc(m_output);
-        last_proc = join(pipeline, last_proc, proc);
+    bool ok = false;
+    if (threaded) {
+        cerr << "Pipeline running " << chain.size() << " stages in threads\n";
+        ok = run_threaded(chain);
     }
     else {
-        cerr << "Pipeline adding #"<<pipeline.size()<<": sink\n";
-        auto sink = new DropSinkProc;
-        last_proc = join(pipeline, last_proc, sink);
+        ok = run_serial(chain);
     }
-
-    // truly last proc needs to be added by hand.
-    pipeline.push_back(last_proc);
-
-
-
-    // A "drain end first" strategy gives attention to draining
-    // queues the more toward the the end of the pipeline they are.
-    // This keeps the overall pipeline empty and leads to "pulse" type
-    // data movement.  It's stupid for multiprocessing but in a single
-    // thread will keep memory usage low.
-    size_t pipelen = pipeline.size();
-    while (true) {
-        bool did_something = false;
-        for (size_t ind = pipelen-1; ind > 0; --ind) { // source has no input
-            SinkProc* proc = dynamic_cast<SinkProc*>(pipeline[ind]);
-            if (proc->input_pipe().empty()) {
-                continue;
-            }
-            bool ok = (*proc)();
-            if (!ok) {
-                std::cerr << "Pipeline failed\n";
-                return;
-            }
-            //std::cerr << "Executed process " << ind << std::endl;
-            did_something = true;
-            break;
-        }
-        if (!did_something) {
-            bool ok = (*pipeline[0])();
-            if (!ok) {
-                std::cerr << "Source empty\n";
-                return;
-            }
-            //std::cerr << "Executed source\n";
-        }
-        // otherwise, go through pipeline again
+    if (!ok) {
+        std::cerr << "Pipeline failed\n";
     }
-
 }
 void Gen::Fourdee::execute_old()
 {
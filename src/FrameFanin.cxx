@@ -2,7 +2,7 @@
 
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Exceptions.h"
-#include "WireCellIface/SimpleFrame.h"
+#include "WireCellGen/FrameView.h"
 
 #include <iostream>
 
@@ -98,7 +98,17 @@ bool Gen::FrameFanin::operator()(const input_vector& invec, output_pointer& out)
     std::vector< std::tuple<tagrules::tag_t, IFrame::trace_list_t, IFrame::trace_summary_t> > stash;
 
     tagrules::tagset_t fouttags;
-    ITrace::vector out_traces;
+
+    // The output trace vector is built once and shared by the output.
+    size_t ntraces = 0;
+    for (const auto& fr : invec) {
+        if (fr) {
+            ntraces += fr->traces()->size();
+        }
+    }
+    auto shared_traces = std::make_shared<ITrace::vector>();
+    ITrace::vector& out_traces = *shared_traces;
+    out_traces.reserve(ntraces);
     IFrame::pointer one = nullptr;
     for (size_t iport=0; iport < m_multiplicity; ++iport) {
         const size_t trace_offset = out_traces.size();
@@ -150,7 +160,7 @@ bool Gen::FrameFanin::operator()(const input_vector& invec, output_pointer& out)
         out_traces.insert(out_traces.end(), traces->begin(), traces->end());
     }
     
-    auto sf = new SimpleFrame(one->ident(), one->time(), out_traces, one->tick());
+    auto sf = std::make_shared<FrameView>(one->ident(), one->time(), one->tick(), shared_traces);
     for (size_t iport=0; iport < m_multiplicity; ++iport) {
         if (m_tags[iport].size()) {
             // std::cerr << "FrameFanin: tagging trace set: " << by_port[iport].size() << " traces from port "
@@ -168,7 +178,7 @@ bool Gen::FrameFanin::operator()(const input_vector& invec, output_pointer& out)
         sf->tag_traces(get<0>(ttt), get<1>(ttt), get<2>(ttt));
     }
 
-    out = IFrame::pointer(sf);
+    out = sf;
     return true;
 }
 
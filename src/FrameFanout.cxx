@@ -2,7 +2,7 @@
 
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Exceptions.h"
-#include "WireCellIface/SimpleFrame.h"
+#include "WireCellGen/FrameView.h"
 
 WIRECELL_FACTORY(FrameFanout, WireCell::Gen::FrameFanout,
                  WireCell::IFrameFanout, WireCell::IConfigurable)
@@ -74,8 +74,8 @@ bool Gen::FrameFanout::operator()(const input_pointer& in, output_vector& outv)
 
     for (size_t ind=0; ind<m_multiplicity; ++ind) {
 
-        // Basic frame stays the same.
-        auto sfout = new SimpleFrame(in->ident(), in->time(), *in->traces(), in->tick());
+        // Basic frame stays the same and is shared.
+        auto sfout = std::make_shared<FrameView>(in);
 
         // Transform any frame tags based on a per output port ruleset
         auto fouttags = m_ft.transform(ind, "frame", fintags);
@@ -90,15 +90,13 @@ bool Gen::FrameFanout::operator()(const input_pointer& in, output_vector& outv)
             if (touttags.empty()) {
                 continue;
             }
-            const auto& traces = in->tagged_traces(inttag);
-            const auto& summary = in->trace_summary(inttag);
             for (auto otag : touttags) {
-                sfout->tag_traces(otag, traces, summary);
+                sfout->tag_traces(otag, in, inttag);
                 taginfo << " " << inttag << "->" << otag;
             }
         };
 
-        outv[ind] = IFrame::pointer(sfout);
+        outv[ind] = sfout;
     }
 
     std::string tagmsg = taginfo.str();
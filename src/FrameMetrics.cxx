@@ -0,0 +1,69 @@
+#include "WireCellGen/FrameMetrics.h"
+#include "WireCellGen/Metrics.h"
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Persist.h"
+#include "WireCellUtil/Exceptions.h"
+
+WIRECELL_FACTORY(FrameMetrics, WireCell::Gen::FrameMetrics,
+                 WireCell::IFrameFilter, WireCell::IConfigurable)
+
+using namespace WireCell;
+
+Gen::FrameMetrics::FrameMetrics()
+    : log(Log::logger("sim"))
+{
+}
+
+Gen::FrameMetrics::~FrameMetrics()
+{
+}
+
+WireCell::Configuration Gen::FrameMetrics::default_configuration() const
+{
+    Configuration cfg;
+
+    /// File to which one line of JSON is appended per frame.  If
+    /// empty, the line is logged at info level instead.
+    cfg["filename"] = m_filename;
+
+    return cfg;
+}
+
+void Gen::FrameMetrics::configure(const WireCell::Configuration& cfg)
+{
+    m_filename = get<std::string>(cfg, "filename", m_filename);
+    if (m_out.is_open()) {
+        m_out.close();
+    }
+    if (!m_filename.empty()) {
+        m_out.open(m_filename.c_str(), std::ios::out | std::ios::app);
+        if (!m_out) {
+            THROW(IOError() << errmsg{"FrameMetrics: failed to open " + m_filename});
+        }
+    }
+    Metrics::instance().enable();
+}
+
+bool Gen::FrameMetrics::operator()(const input_pointer& inframe, output_pointer& outframe)
+{
+    outframe = inframe;
+    if (!inframe) {
+        log->debug("FrameMetrics: EOS");
+        return true;
+    }
+
+    Configuration jrec;
+    jrec["frame"] = inframe->ident();
+    jrec["time"] = inframe->time();
+    jrec["ntraces"] = (int)inframe->traces()->size();
+    jrec["stages"] = Metrics::instance().take();
+
+    const std::string line = Persist::dumps(jrec);
+    if (m_out.is_open()) {
+        m_out << line << std::endl;
+    }
+    else {
+        log->info("FrameMetrics: {}", line);
+    }
+    return true;
+}
@@ -3,14 +3,19 @@
 #include "WireCellIface/SimpleFrame.h"
 
 #include <algorithm>
+#include <functional>
 #include <iostream>
 
 using namespace std;
 using namespace WireCell;
 
 
-typedef std::pair<int, const std::vector<float>* > tbin_charge_t;
-typedef std::map<int, std::vector<tbin_charge_t> > channel_index_t;
+// One trace's data placed on the summed frame's tick.
+struct ChannelPiece {
+    int channel;
+    int tbin;
+    const std::vector<float>* charge;
+};
 
 IFrame::pointer Gen::sum(std::vector<IFrame::pointer> frames, int ident)
 {
@@ -29,44 +34,47 @@ IFrame::pointer Gen::sum(std::vector<IFrame::pointer> frames, int ident)
     auto times_mm = std::minmax_element(times.begin(), times.end());
     const double start_time = *times_mm.first;
     
-    // Make an temporary index mapping channel to all the trace data,
-    // applying time offsets as we fill.
-    channel_index_t index;
+    // Make a flat list of all trace data, applying time offsets as
+    // we fill, and group it by channel with one sort.  The sort is
+    // stable so each channel sums in frame then trace order.
+    size_t ntraces = 0;
+    for (auto frame : frames) {
+        ntraces += frame->traces()->size();
+    }
+    std::vector<ChannelPiece> pieces;
+    pieces.reserve(ntraces);
     for (int ind=0; ind<nframes; ++ind) {
         IFrame::pointer frame = frames[ind];
         const double dt = frame->time() - start_time;
         const int tbinoff = dt/tick;
         for (auto trace : *frame->traces()) {
-            const int ch = trace->channel();
-            const int new_tbin = tbinoff + trace->tbin();
-            index[ch].push_back(make_pair(new_tbin, &(trace->charge())));
+            pieces.push_back(ChannelPiece{trace->channel(), tbinoff + trace->tbin(), &(trace->charge())});
         }
     }
+    std::stable_sort(pieces.begin(), pieces.end(),
+                     [](const ChannelPiece& a, const ChannelPiece& b) {
+                         return a.channel < b.channel;
+                     });
 
     // Process each channel to make flattened trace.
     ITrace::vector out_traces;
-    for (auto ctc : index) {
-        auto ch = ctc.first;
-        auto tcv = ctc.second;  // vector of tbin_charge_t
-        vector<int> tbins;
-        for (auto tc : tcv) {   // go through once to find tbin bounds 
-            const int tbin = tc.first;
-            tbins.push_back(tbin);
-            tbins.push_back(tbin+tc.second->size());
+    auto beg = pieces.begin();
+    while (beg != pieces.end()) {
+        const int ch = beg->channel;
+        auto end = beg;
+        int tbin_min = beg->tbin, tbin_max = beg->tbin;
+        for (; end != pieces.end() && end->channel == ch; ++end) {
+            tbin_min = std::min(tbin_min, end->tbin);
+            tbin_max = std::max(tbin_max, end->tbin + (int)end->charge->size());
         }
-        auto tbin_mm = std::minmax_element(tbins.begin(), tbins.end());
-        const int trace_tbin = *tbin_mm.first;
-        const int trace_nbins = *tbin_mm.second-trace_tbin;
-        vector<float> charge(trace_nbins, 0.0);
-        for (auto tc : tcv) {
-            int ind = tc.first - trace_tbin;
-            for (auto q : *tc.second) {
-                charge[ind] += q;
-                ++ind;
-            }
+        ITrace::ChargeSequence charge(tbin_max - tbin_min, 0.0);
+        for (auto it = beg; it != end; ++it) {
+            const auto& q = *it->charge;
+            float* dst = charge.data() + (it->tbin - tbin_min);
+            std::transform(q.begin(), q.end(), dst, dst, std::plus<float>());
         }
-        ITrace::pointer trace = make_shared<SimpleTrace>(ch, trace_tbin, charge);
-        out_traces.push_back(trace);
+        out_traces.push_back(make_shared<SimpleTrace>(ch, tbin_min, charge));
+        beg = end;
     }
     
     return make_shared<SimpleFrame>(ident, start_time, out_traces, tick);
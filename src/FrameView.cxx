@@ -0,0 +1,81 @@
+#include "WireCellGen/FrameView.h"
+#include "WireCellUtil/Exceptions.h"
+
+#include <algorithm>
+
+using namespace WireCell;
+
+Gen::FrameView::FrameView(const IFrame::pointer& parent)
+    : m_ident(parent->ident())
+    , m_time(parent->time())
+    , m_tick(parent->tick())
+    , m_traces(parent->traces())
+{
+}
+
+Gen::FrameView::FrameView(int ident, double time, double tick, ITrace::shared_vector traces,
+                          const Waveform::ChannelMaskMap& cmm)
+    : m_ident(ident)
+    , m_time(time)
+    , m_tick(tick)
+    , m_traces(traces)
+    , m_cmm(cmm)
+{
+}
+
+Gen::FrameView::~FrameView()
+{
+}
+
+void Gen::FrameView::tag_frame(const tag_t& tag)
+{
+    m_frame_tags.push_back(tag);
+}
+
+void Gen::FrameView::set_tagged(const tag_t& tag, const Tagged& tagged)
+{
+    if (std::find(m_trace_tags.begin(), m_trace_tags.end(), tag) == m_trace_tags.end()) {
+        m_trace_tags.push_back(tag);
+    }
+    m_tagged[tag] = tagged;
+}
+
+void Gen::FrameView::tag_traces(const tag_t& tag, const trace_list_t& indices,
+                                const trace_summary_t& summary)
+{
+    auto owned = std::make_shared<std::pair<trace_list_t, trace_summary_t> >(indices, summary);
+    m_owned.push_back(owned);
+    set_tagged(tag, Tagged{&owned->first, &owned->second});
+}
+
+void Gen::FrameView::tag_traces(const tag_t& tag, const IFrame::pointer& other, const tag_t& other_tag)
+{
+    // Indices from another trace vector would be meaningless here.
+    if (other->traces() != m_traces) {
+        THROW(ValueError() << errmsg{"FrameView: tagged traces must come from a frame sharing the view's traces"});
+    }
+    if (std::find(m_others.begin(), m_others.end(), other) == m_others.end()) {
+        m_others.push_back(other);
+    }
+    set_tagged(tag, Tagged{&other->tagged_traces(other_tag), &other->trace_summary(other_tag)});
+}
+
+const IFrame::trace_list_t& Gen::FrameView::tagged_traces(const tag_t& tag) const
+{
+    static trace_list_t dummy;
+    auto it = m_tagged.find(tag);
+    if (it == m_tagged.end()) {
+        return dummy;
+    }
+    return *it->second.traces;
+}
+
+const IFrame::trace_summary_t& Gen::FrameView::trace_summary(const tag_t& tag) const
+{
+    static trace_summary_t dummy;
+    auto it = m_tagged.find(tag);
+    if (it == m_tagged.end()) {
+        return dummy;
+    }
+    return *it->second.summary;
+}
@@ -1,5 +1,6 @@
 #include "WireCellGen/GaussianDiffusion.h"
 
+#include <algorithm>
 #include <iostream>		// debugging
 
 using namespace WireCell;
@@ -118,6 +119,7 @@ Gen::GaussianDiffusion::GaussianDiffusion(const IDepo::pointer& depo,
     , m_pitch_desc(pitch_desc)
     , m_toffset_bin(-1)
     , m_poffset_bin(-1)
+    , m_pwindow(0, std::numeric_limits<int>::max())
 {
 }
 
@@ -147,6 +149,8 @@ void Gen::GaussianDiffusion::set_sampling(const Binning& tbin, // overall time t
     /// Sample pitch dimension.
     auto pval_range = m_pitch_desc.sigma_range(nsigma);
     auto pbin_range = pbin.sample_bin_range(pval_range.first, pval_range.second);
+    pbin_range.first = std::max(pbin_range.first, m_pwindow.first);
+    pbin_range.second = std::max(pbin_range.first, std::min(pbin_range.second, m_pwindow.second));
     const size_t npss = pbin_range.second - pbin_range.first;
     m_poffset_bin = pbin_range.first;
     //auto pvec = m_pitch_desc.sample(pbin.center(m_poffset_bin), pbin.binsize(), npss);
@@ -0,0 +1,92 @@
+#include "WireCellGen/GenPipeline.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <iostream>
+
+using namespace WireCell;
+
+bool WireCell::run_serial(const std::vector<Proc*>& procs)
+{
+    const size_t nprocs = procs.size();
+    if (nprocs < 2) {
+        std::cerr << "run_serial: need at least a source and a sink\n";
+        return false;
+    }
+
+    while (true) {
+        bool did_something = false;
+        for (size_t ind = nprocs-1; ind > 0; --ind) { // source has no input
+            auto proc = procs[ind];
+            if (!proc->input_ready()) {
+                continue;
+            }
+            if (!(*proc)()) {
+                std::cerr << "run_serial: proc " << ind << " failed\n";
+                return false;
+            }
+            did_something = true;
+            break;
+        }
+        if (!did_something) {
+            if (!(*procs[0])()) {
+                return !procs[0]->failed(); // source is exhausted
+            }
+        }
+        // otherwise, go through pipeline again
+    }
+}
+
+bool WireCell::run_threaded(const std::vector<Proc*>& procs)
+{
+    std::atomic<bool> failed(false);
+    auto abort_all = [&]() {
+        failed = true;
+        for (auto proc : procs) {
+            proc->close_input();
+            proc->close_output();
+        }
+    };
+
+    // The first exception thrown by any proc, to rethrow once all
+    // threads are joined.
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    std::vector<std::thread> threads;
+    for (size_t ind=0; ind<procs.size(); ++ind) {
+        threads.emplace_back([&, ind]() {
+                auto proc = procs[ind];
+                try {
+                    while ((*proc)()) {
+                        ;
+                    }
+                }
+                catch (...) {
+                    std::cerr << "run_threaded: proc " << ind << " threw\n";
+                    {
+                        std::lock_guard<std::mutex> lock(error_mutex);
+                        if (!error) {
+                            error = std::current_exception();
+                        }
+                    }
+                    abort_all();
+                    return;
+                }
+                proc->close_output();
+                if (proc->failed()) {
+                    std::cerr << "run_threaded: proc " << ind << " failed\n";
+                    abort_all();
+                }
+            });
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return !failed;
+}
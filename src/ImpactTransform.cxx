@@ -1,15 +1,23 @@
 #include "WireCellGen/ImpactTransform.h"
+#include "WireCellGen/Metrics.h"
+#include "WireCellGen/PlaneImpactResponse.h"
 #include "WireCellUtil/Testing.h"
 #include "WireCellUtil/FFTBestLength.h"
 
+#include <algorithm>
 #include <iostream>             // debugging.
+#include <limits>
+#include <numeric>
 using namespace std;
 
 using namespace WireCell;
-Gen::ImpactTransform::ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedDiffusion_transform& bd)
+Gen::ImpactTransform::ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedDiffusion_transform& bd,
+                                      size_t max_bytes, bool roi, bool split)
   :m_pir(pir), m_bd(bd)
+  , m_split(false)
   , log(Log::logger("sim"))
 {
+  MetricsTimer timer("ImpactTransform");
 
   // for (int i=0;i!=210;i++){
   //   double pos = -31.5 + 0.3*i+1e-9;0
@@ -41,7 +49,6 @@ Gen::ImpactTransform::ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedD
     
     for (int j=0;j!=m_pir->nwires();j++){
       map_resp[j-m_num_pad_wire] = m_pir->closest(rel_cen_imp_pos - (j-m_num_pad_wire)*m_pir->pitch());
-      Waveform::compseq_t response_spectrum = map_resp[j-m_num_pad_wire]->spectrum();
       
       //	std::cout << i << " " << j << " " << rel_cen_imp_pos - (j-m_num_pad_wire)*m_pir->pitch()<< " " << response_spectrum.size() << std::endl;
     }
@@ -82,363 +89,518 @@ Gen::ImpactTransform::ImpactTransform(IPlaneImpactResponse::pointer pir, BinnedD
   std::pair<int,int> impact_range = m_bd.impact_bin_range(m_bd.get_nsigma());
   std::pair<int,int> time_range = m_bd.time_bin_range(m_bd.get_nsigma());
 
-  //  std::cout << impact_range.first << " " << impact_range.second << " " << time_range.first << " " << time_range.second << std::endl;
-
   int start_ch = std::floor(impact_range.first*1.0/(m_num_group-1))-1;
   int end_ch = std::ceil(impact_range.second*1.0/(m_num_group-1))+2;
   if ( (end_ch-start_ch)%2==1) end_ch += 1;
   int start_tick = time_range.first-1;
   int end_tick = time_range.second+2;
   if ( (end_tick-start_tick)%2==1 ) end_tick += 1;
+
+  m_npad_time = m_pir->closest(0)->waveform_pad();
+  if (split) {
+    auto gpir = std::dynamic_pointer_cast<Gen::PlaneImpactResponse>(m_pir);
+    if (gpir && !gpir->short_waveform().empty()) {
+      m_split = true;
+      m_short_waveform = gpir->short_waveform();
+      m_npad_time = gpir->field_pad();
+    }
+    else {
+      log->debug("ImpactTransform: no separate short response, using combined response");
+    }
+  }
+
+  // Choose the tiles.  Without ROI tiling or a memory budget, one
+  // tile covers all charge and the result is that of a single 2D
+  // convolution.
+  const Tile domain{start_ch, end_ch - start_ch, start_tick, end_tick - start_tick};
+
+  // A coarse grid over the domain used to find occupied regions and
+  // to assign charges to tiles.
+  m_cell_nch = std::max(2*m_num_pad_wire, 8);
+  m_cell_nticks = std::max(m_npad_time, 64);
+  const int ncells_ch = (domain.nch + m_cell_nch - 1) / m_cell_nch;
+  const int ncells_tick = (domain.ntick + m_cell_nticks - 1) / m_cell_nticks;
+  auto cell_of = [&](int ch, int tick) {
+    const int icc = std::min(ncells_ch-1, std::max(0, (ch-start_ch)/m_cell_nch));
+    const int ict = std::min(ncells_tick-1, std::max(0, (tick-start_tick)/m_cell_nticks));
+    return icc*ncells_tick + ict;
+  };
+
+  std::vector<Tile> boxes;
+  if (roi) {
+    std::vector<bool> occupied(ncells_ch*ncells_tick, false);
+    for (const auto& charges : m_vec_vec_charge) {
+      for (const auto& q : charges) {
+        occupied[cell_of(std::get<0>(q), std::get<1>(q))] = true;
+      }
+    }
+    boxes = roi_tiles(domain, occupied, ncells_ch, ncells_tick);
+  }
+  else {
+    boxes.push_back(domain);
+  }
+
+  std::vector<Tile> tiles;
+  auto& metrics = Metrics::instance();
+  if (max_bytes > 0) {
+    // The output is held whole, regardless of tiling, so it comes
+    // out of the budget.  It spans the padded tiles, so split again
+    // while its size leaves less for each tile than was assumed.
+    size_t tile_budget = max_bytes;
+    size_t out_bytes = 0;
+    for (int ntries=0; ntries<4; ++ntries) {
+      tiles.clear();
+      for (const auto& box : boxes) {
+        split_tile(box, tile_budget, tiles);
+      }
+      out_bytes = output_bytes(tiles);
+      const size_t left = max_bytes > out_bytes ? max_bytes - out_bytes : 0;
+      if (left >= tile_budget) {
+        break;
+      }
+      tile_budget = left;
+    }
+    size_t peak_tile = 0;
+    for (const auto& tile : tiles) {
+      peak_tile = std::max(peak_tile, tile_bytes(tile));
+    }
+    metrics.peak("ImpactTransform", "tile_bytes_estimate", peak_tile);
+    if (out_bytes + peak_tile > max_bytes) {
+      log->warn("ImpactTransform: output of {} MB plus tiles of {} MB exceed the {} MB budget",
+                out_bytes/(1024*1024), peak_tile/(1024*1024), max_bytes/(1024*1024));
+    }
+  }
+  else {
+    tiles = boxes;
+  }
+  const size_t ntiles = tiles.size();
+
+  // When tiled, the response is cut at its padding so that it can
+  // not wrap around a tile.  Otherwise it is cut at the full FFT
+  // length.
+  const int nkeep = ntiles > 1 ? m_npad_time : 0;
+
+  // The output spans the union of the padded tiles.
+  const Tile whole = tiles_union(tiles);
+  m_start_ch = whole.ch0;
+  m_end_ch = whole.ch0 + whole.nch;
+  m_start_tick = whole.tick0;
+  m_end_tick = whole.tick0 + whole.ntick;
+  m_decon_data = Array::array_xxf::Zero(m_end_ch - m_start_ch, m_end_tick - m_start_tick);
+
+  // The tiles are disjoint.  List those touching each cell.
+  std::vector< std::vector<int> > cell_tiles;
+  if (ntiles > 1) {
+    cell_tiles.resize(ncells_ch*ncells_tick);
+    for (size_t itile=0; itile<ntiles; ++itile) {
+      const auto& tile = tiles[itile];
+      const int icc0 = (tile.ch0 - start_ch)/m_cell_nch;
+      const int icc1 = (tile.ch0 + tile.nch - 1 - start_ch)/m_cell_nch;
+      const int ict0 = (tile.tick0 - start_tick)/m_cell_nticks;
+      const int ict1 = (tile.tick0 + tile.ntick - 1 - start_tick)/m_cell_nticks;
+      for (int icc=icc0; icc<=icc1; ++icc) {
+        for (int ict=ict0; ict<=ict1; ++ict) {
+          cell_tiles[icc*ncells_tick + ict].push_back(itile);
+        }
+      }
+    }
+  }
+  auto tile_of = [&](const charge_t& q) {
+    const int ch = std::get<0>(q), tick = std::get<1>(q);
+    for (int itile : cell_tiles[cell_of(ch, tick)]) {
+      const auto& tile = tiles[itile];
+      if (ch >= tile.ch0 && ch < tile.ch0 + tile.nch &&
+          tick >= tile.tick0 && tick < tile.tick0 + tile.ntick) {
+        return itile;
+      }
+    }
+    return (int)ntiles;         // in no tile
+  };
+
+  // Order each group's charges by tile so that each tile sees one
+  // contiguous run of each group.
+  std::vector< std::vector<size_t> > offsets(m_vec_vec_charge.size());
+  size_t ncharges = 0;
+  for (size_t igroup=0; igroup<m_vec_vec_charge.size(); ++igroup) {
+    auto& charges = m_vec_vec_charge[igroup];
+    ncharges += charges.size();
+    auto& off = offsets[igroup];
+    off.resize(ntiles+2, 0);
+    if (ntiles == 1) {
+      off[1] = off[2] = charges.size();
+      continue;
+    }
+    for (const auto& q : charges) {
+      ++off[tile_of(q)+1];
+    }
+    std::partial_sum(off.begin(), off.end(), off.begin());
+    std::vector<size_t> next(off.begin(), off.end()-1);
+    std::vector<charge_t> sorted(charges.size());
+    for (const auto& q : charges) {
+      sorted[next[tile_of(q)]++] = q;
+    }
+    charges.swap(sorted);
+    if (off[ntiles+1] > off[ntiles]) {
+      log->warn("ImpactTransform: {} charges outside of all tiles",
+                off[ntiles+1] - off[ntiles]);
+    }
+  }
+  metrics.count("ImpactTransform", "charges", ncharges);
+  metrics.count("ImpactTransform", "tiles", ntiles);
+
+  std::vector<charge_range> ranges(m_vec_vec_charge.size());
+  for (size_t itile=0; itile<ntiles; ++itile) {
+    for (size_t igroup=0; igroup<m_vec_vec_charge.size(); ++igroup) {
+      auto beg = m_vec_vec_charge[igroup].cbegin();
+      ranges[igroup] = charge_range(beg + offsets[igroup][itile], beg + offsets[igroup][itile+1]);
+    }
+    convolve_tile(tiles[itile], ranges, nkeep);
+  }
+  if (m_split) {
+    apply_short_response();
+  }
+  metrics.peak("ImpactTransform", "output_bytes",
+               sizeof(float) * m_decon_data.rows() * (size_t)m_decon_data.cols());
+
+  for (auto& charges : m_vec_vec_charge) {
+    charges.clear();
+    charges.shrink_to_fit();
+  }
+  m_resp_spectra.clear();
+  m_resp_heads.clear();
+
+  log->debug("ImpactTransform: # of channels: {} # of ticks: {} in {} tiles",
+             m_decon_data.rows(), m_decon_data.cols(), ntiles);
   
-  
-  //  m_decon_data = Array::array_xxf::Zero(nwires+2*m_num_pad_wire,nsamples);    
+} // constructor
+
+
+void Gen::ImpactTransform::tile_shape(const Tile& tile, int& ch_lo, int& nrows, int& ncols) const
+{
+  // Pad in wire by at least the response reach on either side so
+  // that the circular convolution in wire does not wrap.
+  const int nwires_fft = fft_best_length(tile.nch + 2 * m_num_pad_wire, 1);
+  const int npad_wire = (nwires_fft - tile.nch)/2;
+  ch_lo = tile.ch0 - npad_wire;
+  nrows = tile.nch + 2*npad_wire;
+  ncols = fft_best_length(tile.ntick + m_npad_time);
+}
+
+size_t Gen::ImpactTransform::tile_bytes(const Tile& tile) const
+{
+  // A tile holds an accumulator, a charge and a response array plus
+  // a temporary from the FFTs, and the spectra cache.
+  const size_t cbytes = sizeof(std::complex<float>);
+  const size_t nspectra = (m_num_group/2 + 1) * (2*m_num_pad_wire + 1);
+  int ch_lo=0, nrows=0, ncols=0;
+  tile_shape(tile, ch_lo, nrows, ncols);
+  return 4*cbytes*nrows*(size_t)ncols + nspectra*cbytes*ncols;
+}
+
+Gen::ImpactTransform::Tile Gen::ImpactTransform::tiles_union(const std::vector<Tile>& tiles) const
+{
+  int ch0 = std::numeric_limits<int>::max(), tick0 = ch0;
+  int ch1 = std::numeric_limits<int>::min(), tick1 = ch1;
+  for (const auto& tile : tiles) {
+    int ch_lo=0, nrows=0, ncols=0;
+    tile_shape(tile, ch_lo, nrows, ncols);
+    ch0 = std::min(ch0, ch_lo);
+    ch1 = std::max(ch1, ch_lo + nrows);
+    tick0 = std::min(tick0, tile.tick0);
+    tick1 = std::max(tick1, tile.tick0 + ncols);
+  }
+  return Tile{ch0, ch1 - ch0, tick0, tick1 - tick0};
+}
+
+size_t Gen::ImpactTransform::output_bytes(const std::vector<Tile>& tiles) const
+{
+  const Tile whole = tiles_union(tiles);
+  // The short responses extend the output in time.
+  const int ncols = m_split ? fft_best_length(whole.ntick + m_short_waveform.size()) : whole.ntick;
+  return sizeof(float) * whole.nch * (size_t)ncols;
+}
+
+void Gen::ImpactTransform::split_tile(const Tile& box, size_t max_bytes, std::vector<Tile>& tiles) const
+{
+  // Tiles shorter in time than the response, or narrower than the
+  // wire halo, cost more in padding than they save.  Shorten in
+  // time first as the wire halo is relatively more costly.
+  int tile_nch = box.nch;
+  int tile_nticks = box.ntick;
+  while (tile_bytes(Tile{0, tile_nch, 0, tile_nticks}) > max_bytes) {
+    if (tile_nticks > m_cell_nticks) {
+      tile_nticks = std::max(m_cell_nticks, (tile_nticks+1)/2);
+    }
+    else if (tile_nch > m_cell_nch) {
+      tile_nch = std::max(m_cell_nch, (tile_nch+1)/2);
+    }
+    else {
+      log->warn("ImpactTransform: can not tile {} wires x {} ticks within {} MB",
+                box.nch, box.ntick, max_bytes/(1024*1024));
+      break;
+    }
+  }
+  for (int ch0 = box.ch0; ch0 < box.ch0 + box.nch; ch0 += tile_nch) {
+    for (int tick0 = box.tick0; tick0 < box.tick0 + box.ntick; tick0 += tile_nticks) {
+      tiles.push_back(Tile{ch0, std::min(tile_nch, box.ch0 + box.nch - ch0),
+                           tick0, std::min(tile_nticks, box.tick0 + box.ntick - tick0)});
+    }
+  }
+}
+
+std::vector<Gen::ImpactTransform::Tile>
+Gen::ImpactTransform::roi_tiles(const Tile& domain, const std::vector<bool>& occupied,
+                                int ncells_ch, int ncells_tick) const
+{
+  // Inclusive ranges of cells.
+  struct Box { int c0, c1, t0, t1; };
+
+  // Bound each group of 8-connected occupied cells.
+  std::vector<Box> boxes;
+  std::vector<bool> seen(occupied.size(), false);
+  std::vector<int> stack;
+  for (int first=0; first<(int)occupied.size(); ++first) {
+    if (!occupied[first] || seen[first]) {
+      continue;
+    }
+    Box box{first/ncells_tick, first/ncells_tick, first%ncells_tick, first%ncells_tick};
+    seen[first] = true;
+    stack.push_back(first);
+    while (!stack.empty()) {
+      const int cell = stack.back();
+      stack.pop_back();
+      const int icc = cell/ncells_tick, ict = cell%ncells_tick;
+      box.c0 = std::min(box.c0, icc); box.c1 = std::max(box.c1, icc);
+      box.t0 = std::min(box.t0, ict); box.t1 = std::max(box.t1, ict);
+      for (int jcc = std::max(0, icc-1); jcc <= std::min(ncells_ch-1, icc+1); ++jcc) {
+        for (int jct = std::max(0, ict-1); jct <= std::min(ncells_tick-1, ict+1); ++jct) {
+          const int other = jcc*ncells_tick + jct;
+          if (occupied[other] && !seen[other]) {
+            seen[other] = true;
+            stack.push_back(other);
+          }
+        }
+      }
+    }
+    boxes.push_back(box);
+  }
+
+  auto to_tile = [&](const Box& box) {
+    const int ch0 = domain.ch0 + box.c0*m_cell_nch;
+    const int ch1 = std::min(domain.ch0 + domain.nch, domain.ch0 + (box.c1+1)*m_cell_nch);
+    const int tick0 = domain.tick0 + box.t0*m_cell_nticks;
+    const int tick1 = std::min(domain.tick0 + domain.ntick, domain.tick0 + (box.t1+1)*m_cell_nticks);
+    return Tile{ch0, ch1-ch0, tick0, tick1-tick0};
+  };
+  auto cost = [&](const Box& box) {
+    int ch_lo=0, nrows=0, ncols=0;
+    tile_shape(to_tile(box), ch_lo, nrows, ncols);
+    return (double)nrows*ncols;
+  };
+
+  // Merge two boxes if their padded outputs overlap, which also
+  // keeps the tiles disjoint, or if their union costs no more to
+  // convolve than the two apart.  A cell is no smaller than the
+  // padding so overlap is tested with one cell to spare.
+  bool merged = true;
+  while (merged) {
+    merged = false;
+    for (size_t i=0; i<boxes.size() && !merged; ++i) {
+      for (size_t j=i+1; j<boxes.size() && !merged; ++j) {
+        const Box& a = boxes[i];
+        const Box& b = boxes[j];
+        const Box u{std::min(a.c0,b.c0), std::max(a.c1,b.c1),
+                    std::min(a.t0,b.t0), std::max(a.t1,b.t1)};
+        const bool overlap = a.c0-1 <= b.c1 && b.c0-1 <= a.c1 && a.t0-1 <= b.t1 && b.t0-1 <= a.t1;
+        if (overlap || cost(u) <= cost(a) + cost(b)) {
+          boxes[i] = u;
+          boxes.erase(boxes.begin()+j);
+          merged = true;
+        }
+      }
+    }
+  }
+
+  std::vector<Tile> tiles;
+  for (const auto& box : boxes) {
+    tiles.push_back(to_tile(box));
+  }
+  return tiles;
+}
+
+const std::vector<Waveform::compseq_t>&
+Gen::ImpactTransform::response_spectra(int group, int ncols, int nkeep)
+{
+  auto key = std::make_pair(group, ncols);
+  auto it = m_resp_spectra.find(key);
+  if (it != m_resp_spectra.end()) {
+    return it->second;
+  }
+  if (nkeep <= 0 || nkeep > ncols) {
+    nkeep = ncols;
+  }
+  auto& spectra = m_resp_spectra[key];
+  for (int off = -m_num_pad_wire; off <= m_num_pad_wire; ++off) {
+    // Keep the first samples in time and forward again at the tile
+    // length.
+    const auto& wave = response_head(group, off, nkeep);
+    Waveform::realseq_t reduced(ncols, 0);
+    const int ncopy = std::min(nkeep, (int)wave.size());
+    std::copy(wave.begin(), wave.begin()+ncopy, reduced.begin());
+    spectra.push_back(Waveform::dft(reduced));
+  }
+  size_t nbytes = 0;
+  for (const auto& it : m_resp_spectra) {
+    for (const auto& spec : it.second) {
+      nbytes += sizeof(Waveform::complex_t) * spec.size();
+    }
+  }
+  Metrics::instance().peak("ImpactTransform", "spectra_bytes", nbytes);
+  return spectra;
+}
+
+const Waveform::realseq_t& Gen::ImpactTransform::response_head(int group, int off, int nkeep)
+{
+  auto ir = m_vec_map_resp.at(group)[off];
+  auto gir = std::dynamic_pointer_cast<Gen::ImpactResponse>(ir);
+  // In split mode the 2D convolution is with the field response
+  // alone.  Only Gen responses may be split.
+  const bool field_only = m_split && gir;
+  const size_t nfull = field_only ? gir->field_waveform().size()
+    : (gir ? gir->nticks() : ir->waveform().size());
+  auto& head = m_resp_heads[std::make_pair(group, off)];
+  if (head.size() >= std::min((size_t)nkeep, nfull)) {
+    return head;
+  }
+  if (gir) {
+    head = gir->waveform_head(nkeep, field_only);
+  }
+  else {
+    const auto& wave = ir->waveform();
+    head.assign(wave.begin(), wave.begin() + std::min((size_t)nkeep, wave.size()));
+  }
+  return head;
+}
+
+Array::array_xxc Gen::ImpactTransform::response_array(int group, int nrows, int ncols, int nkeep)
+{
+  const auto& spectra = response_spectra(group, ncols, nkeep);
+  Array::array_xxc resp_f_w = Array::array_xxc::Zero(nrows, ncols);
+  for (int icol = 0; icol != ncols; icol++){
+    resp_f_w(0,icol) = spectra[m_num_pad_wire][icol];
+  }
+  for (int irow = 0; irow!=m_num_pad_wire;irow++){
+    const auto& rs1 = spectra[m_num_pad_wire + irow + 1];
+    const auto& rs2 = spectra[m_num_pad_wire - irow - 1];
+    for (int icol = 0; icol != ncols; icol++){
+      resp_f_w(irow+1,icol) = rs1[icol];
+      resp_f_w(nrows-1-irow,icol) = rs2[icol];
+    }
+  }
+  // Do FFT on wire for response
+  return Array::dft_cc(resp_f_w,1);
+}
+
+void Gen::ImpactTransform::convolve_tile(const Tile& tile, const std::vector<charge_range>& charges, int nkeep)
+{
+  int ch_lo=0, nrows=0, ncols=0;
+  tile_shape(tile, ch_lo, nrows, ncols);
+
   // for saving the accumulated wire data in the time frequency domain ...
-  // adding no padding now, it make the FFT slower, need some other methods ... 
-  
-  int npad_wire =0;
-  const size_t ntotal_wires = fft_best_length(end_ch - start_ch + 2 * m_num_pad_wire,1);
-
-  //   pow(2,std::ceil(log(end_ch - start_ch + 2 * m_num_pad_wire)/log(2)));
-  //  if (nwires == 2400){
-  // if (ntotal_wires > 2500)
-  //   ntotal_wires = 2500;
-  // }else if (nwires ==3456){
-  // if (ntotal_wires > 3600)
-  //   ntotal_wires = 3600;
-    //      npad_wire=72; //3600
-  //}
-  npad_wire= (ntotal_wires -end_ch + start_ch)/2;
-  m_start_ch = start_ch - npad_wire;
-  m_end_ch = end_ch + npad_wire;
-  //std::cout << start_ch << " " << end_ch << " " << npad_wire << " " << start_tick << " " << end_tick << " " << m_start_ch << " " << m_end_ch << std::endl;
+  Array::array_xxc acc_data_f_w = Array::array_xxc::Zero(nrows, ncols);
 
-  
-  int npad_time = m_pir->closest(0)->waveform_pad();
-  const size_t ntotal_ticks = fft_best_length(end_tick - start_tick + npad_time);
-
-  // pow(2,std::ceil(log(end_tick - start_tick + npad_time)/log(2)));
-  // if (ntotal_ticks >9800 && nsamples <9800 && nsamples >9550)
-  //  ntotal_ticks = 9800;
-  npad_time = ntotal_ticks - end_tick + start_tick;
-  m_start_tick = start_tick;
-  m_end_tick = end_tick + npad_time;
-  
-  // m_end_tick = 16384;//nsamples;
-  // m_start_tick = 0;
-  // // std::cout << m_start_tick << " " << m_end_tick << std::endl;
-  // int npad_time = 0;
-  // int ntotal_ticks = pow(2,std::ceil(log(nsamples + npad_time)/log(2)));
-  // if (ntotal_ticks >9800 && nsamples <9800)
-  //   ntotal_ticks = 9800
-  // npad_time = ntotal_ticks - nsamples;
-  // m_start_tick = 0;
-  // m_end_tick = ntotal_ticks;
-  
-  
-  Array::array_xxc acc_data_f_w = Array::array_xxc::Zero(end_ch-start_ch+2*npad_wire, m_end_tick - m_start_tick); 
-  
-  int num_double = (m_vec_vec_charge.size()-1)/2;
-  //int num_double = (m_vec_spmatrix.size()-1)/2;
-  
-  // speed up version , first five
+  {
+    // The size of each of the accumulator, charge and response
+    // arrays, of which all three are held at once.
+    auto& metrics = Metrics::instance();
+    metrics.peak("ImpactTransform", "fft_nwires", nrows);
+    metrics.peak("ImpactTransform", "fft_nticks", ncols);
+    metrics.peak("ImpactTransform", "fft_array_bytes", sizeof(std::complex<float>) * nrows * (size_t)ncols);
+  }
+
+  const int num_double = (charges.size()-1)/2;
+
+  // Mirrored pairs of impact groups share one complex convolution.
+  // Group i fills the real part in wire order and its mirror group
+  // fills the imaginary part in reversed wire order, both relative
+  // to this tile, so the response of group i serves both.
   for (int i=0;i!=num_double;i++){
-    //if (i!=0) continue;
-    // std::cout << i << std::endl;
-    Array::array_xxc c_data = Array::array_xxc::Zero(end_ch-start_ch+2*npad_wire,m_end_tick - m_start_tick);
+    Array::array_xxc c_data = Array::array_xxc::Zero(nrows, ncols);
     
     // fill normal order
-    for (size_t j=0;j!=m_vec_vec_charge.at(i).size();j++){
-      c_data(std::get<0>(m_vec_vec_charge.at(i).at(j))+npad_wire-start_ch,std::get<1>(m_vec_vec_charge.at(i).at(j))-m_start_tick) +=  std::get<2>(m_vec_vec_charge.at(i).at(j));
+    for (auto it = charges[i].first; it != charges[i].second; ++it) {
+      c_data(std::get<0>(*it)-ch_lo, std::get<1>(*it)-tile.tick0) += std::get<2>(*it);
     }
-    //    std::cout << i << " " << m_vec_vec_charge.at(i).size() << std::endl;
-    m_vec_vec_charge.at(i).clear();
-    m_vec_vec_charge.at(i).shrink_to_fit();
-
-    // useing matrix form ...
-    // for (int k=0; k<m_vec_spmatrix.at(i)->outerSize(); ++k)
-    //   for (Eigen::SparseMatrix<float>::InnerIterator it(*m_vec_spmatrix.at(i),k); it; ++it){
-    // 	c_data(it.col()+npad_wire-start_ch,it.row()-m_start_tick) = it.value();
-    //   }
-    // delete m_vec_spmatrix.at(i);
-    // //m_vec_spmatrix.at(i).setZero();
-    // //m_vec_spmatrix.at(i).resize(0,0);
-    
     // fill reverse order
-    int ii=num_double*2-i;
-    for (size_t j=0;j!=m_vec_vec_charge.at(ii).size();j++){
-      c_data(end_ch+npad_wire-1-std::get<0>(m_vec_vec_charge.at(ii).at(j)),std::get<1>(m_vec_vec_charge.at(ii).at(j))-m_start_tick) +=  std::complex<float>(0,std::get<2>(m_vec_vec_charge.at(ii).at(j)));
+    const int ii=num_double*2-i;
+    for (auto it = charges[ii].first; it != charges[ii].second; ++it) {
+      c_data(nrows-1-(std::get<0>(*it)-ch_lo), std::get<1>(*it)-tile.tick0) += std::complex<float>(0,std::get<2>(*it));
     }
-    //    std::cout << ii << " " << m_vec_vec_charge.at(ii).size() << std::endl;
-    m_vec_vec_charge.at(ii).clear();
-    m_vec_vec_charge.at(ii).shrink_to_fit();
-    // for (int k=0; k<m_vec_spmatrix.at(ii)->outerSize(); ++k)
-    //   for (Eigen::SparseMatrix<float>::InnerIterator it(*m_vec_spmatrix.at(ii),k); it; ++it){
-    // 	c_data(it.col()+npad_wire-start_ch,it.row()-m_start_tick) = it.value();
-    //   }
-    // delete m_vec_spmatrix.at(ii);
-    // //    m_vec_spmatrix.at(ii).setZero();
-    // //m_vec_spmatrix.at(ii).resize(0,0);
-    
     
     // Do FFT on time
     c_data = Array::dft_cc(c_data,0);
     // Do FFT on wire
     c_data = Array::dft_cc(c_data,1);
-    
-    // std::cout << i << std::endl;
-    {
-      Array::array_xxc resp_f_w = Array::array_xxc::Zero(end_ch-start_ch+2*npad_wire,m_end_tick - m_start_tick);
-      {
-	Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[0]->spectrum();
-	// do a inverse FFT
-	Waveform::realseq_t rs1_t = Waveform::idft(rs1);
-	// pick the first xxx ticks
-	Waveform::realseq_t rs1_reduced(m_end_tick-m_start_tick,0);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs1_t.size())) break;
-	  rs1_reduced.at(icol) = rs1_t[icol];
-	}
-	// do a FFT
-	rs1 = Waveform::dft(rs1_reduced);
-	
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  resp_f_w(0,icol) = rs1[icol];
-	}
-      }
-      
-      
-      for (int irow = 0; irow!=m_num_pad_wire;irow++){
-	Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[irow+1]->spectrum();
-	Waveform::realseq_t rs1_t = Waveform::idft(rs1);
-	Waveform::realseq_t rs1_reduced(m_end_tick-m_start_tick,0);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs1_t.size())) break;
-	  rs1_reduced.at(icol) = rs1_t[icol];
-	}
-	rs1 = Waveform::dft(rs1_reduced);
-	Waveform::compseq_t rs2 = m_vec_map_resp.at(i)[-irow-1]->spectrum();
-	Waveform::realseq_t rs2_t = Waveform::idft(rs2);
-	Waveform::realseq_t rs2_reduced(m_end_tick-m_start_tick,0);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs2_t.size())) break;
-	  rs2_reduced.at(icol) = rs2_t[icol];
-	}
-	rs2 = Waveform::dft(rs2_reduced);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  resp_f_w(irow+1,icol) = rs1[icol];
-	  resp_f_w(end_ch-start_ch-1-irow+2*npad_wire,icol) = rs2[icol];
-	}
-      }
-      //std::cout << i << std::endl;
-      
-      // Do FFT on wire for response // slight larger
-      resp_f_w = Array::dft_cc(resp_f_w,1); // Now becomes the f and f in both time and wire domain ...
-      // multiply them together
-      c_data = c_data * resp_f_w;
-    }
-    
-    
+    // multiply with the response
+    c_data = c_data * response_array(i, nrows, ncols, nkeep);
     // Do inverse FFT on wire
     c_data = Array::idft_cc(c_data,1);
-    
     // Add to wire result in frequency
     acc_data_f_w += c_data;
-    
   }
   
-  // std::cout << "ABC : " << std::endl;
-  
   // central region ...
   {
-    int i = num_double;
-    // fill response array in frequency domain
-    
+    const int i = num_double;
     Array::array_xxc data_f_w;
     {
-      Array::array_xxf data_t_w = Array::array_xxf::Zero(end_ch-start_ch+2*npad_wire,m_end_tick-m_start_tick);
-      // fill charge array in time-wire domain // slightly larger
-      for (size_t j=0;j!=m_vec_vec_charge.at(i).size();j++){
-      	data_t_w(std::get<0>(m_vec_vec_charge.at(i).at(j))+npad_wire-start_ch,std::get<1>(m_vec_vec_charge.at(i).at(j))-m_start_tick) +=  std::get<2>(m_vec_vec_charge.at(i).at(j));
-      	// std::cout << std::get<1>(m_vec_vec_charge.at(i).at(j)) << std::endl;
+      Array::array_xxf data_t_w = Array::array_xxf::Zero(nrows, ncols);
+      for (auto it = charges[i].first; it != charges[i].second; ++it) {
+        data_t_w(std::get<0>(*it)-ch_lo, std::get<1>(*it)-tile.tick0) += std::get<2>(*it);
       }
-      //      std::cout << i << " " << m_vec_vec_charge.at(i).size() << std::endl;
-      m_vec_vec_charge.at(i).clear();
-      m_vec_vec_charge.at(i).shrink_to_fit();
-      // for (int k=0; k<m_vec_spmatrix.at(i)->outerSize(); ++k)
-      // 	for (Eigen::SparseMatrix<float>::InnerIterator it(*m_vec_spmatrix.at(i),k); it; ++it){
-      // 	  data_t_w(it.col()+npad_wire-start_ch,it.row()-m_start_tick) = it.value();
-      // 	}
-      // delete m_vec_spmatrix.at(i);
-      // //      m_vec_spmatrix.at(i).setZero();
-      // // m_vec_spmatrix.at(i).resize(0,0);
-      
-      
-      
       // Do FFT on time
       data_f_w = Array::dft_rc(data_t_w,0);
       // Do FFT on wire
       data_f_w = Array::dft_cc(data_f_w,1);
     }
-    
-    {
-      Array::array_xxc resp_f_w = Array::array_xxc::Zero(end_ch-start_ch+2*npad_wire,m_end_tick-m_start_tick);
-      
-      {
-	Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[0]->spectrum();
-	// Array::array_xxc temp_resp_f_w = Array::array_xxc::Zero(2*m_num_pad_wire+1,nsamples);
-	// for (int icol = 0; icol != nsamples; icol++){
-	//   temp_resp_f_w(0,icol) = rs1[icol];
-	// }
-	// Array::array_xxf temp_resp_t_w = Array::idft_cr(temp_resp_f_w,0).block(0,0,2*m_num_pad_wire+1,m_end_tick-m_start_tick);
-	// temp_resp_f_w = Array::dft_rc(temp_resp_t_w,0);
-	
-	// do a inverse FFT
-	Waveform::realseq_t rs1_t = Waveform::idft(rs1);
-	// pick the first xxx ticks
-	Waveform::realseq_t rs1_reduced(m_end_tick-m_start_tick,0);
-	// std::cout << rs1.size() << " " << nsamples << " " << m_end_tick << " " <<  m_start_tick << std::endl;
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs1_t.size())) break;
-	  rs1_reduced.at(icol) = rs1_t[icol];
-	  //  std::cout << icol << " " << rs1_t[icol] << std::endl;
-	}
-	// do a FFT
-	rs1 = Waveform::dft(rs1_reduced);
-	
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  //   std::cout << icol << " " << rs1[icol] << " " << temp_resp_f_w(0,icol) << std::endl;
-	  resp_f_w(0,icol) = rs1[icol];
-	}
-      }
-      for (int irow = 0; irow!=m_num_pad_wire;irow++){
-	Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[irow+1]->spectrum();
-	Waveform::realseq_t rs1_t = Waveform::idft(rs1);
-	Waveform::realseq_t rs1_reduced(m_end_tick-m_start_tick,0);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs1_t.size())) break;
-	  rs1_reduced.at(icol) = rs1_t[icol];
-	}
-	rs1 = Waveform::dft(rs1_reduced);
-	Waveform::compseq_t rs2 = m_vec_map_resp.at(i)[-irow-1]->spectrum();
-	Waveform::realseq_t rs2_t = Waveform::idft(rs2);
-	Waveform::realseq_t rs2_reduced(m_end_tick-m_start_tick,0);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  if (icol >= int(rs2_t.size())) break;
-	  rs2_reduced.at(icol) = rs2_t[icol];
-	}
-	rs2 = Waveform::dft(rs2_reduced);
-	for (int icol = 0; icol != m_end_tick-m_start_tick; icol++){
-	  resp_f_w(irow+1,icol) = rs1[icol];
-	  resp_f_w(end_ch-start_ch-1-irow+2*npad_wire,icol) = rs2[icol];
-	}
-	// for (int icol = 0; icol != nsamples; icol++){
-	//   resp_f_w(irow+1,icol) = rs1[icol];
-	//   resp_f_w(end_ch-start_ch-1-irow+2*npad_wire,icol) = rs2[icol];
-	// }
-      }
-      // Do FFT on wire for response // slight larger
-      resp_f_w = Array::dft_cc(resp_f_w,1); // Now becomes the f and f in both time and wire domain ...
-      // multiply them together
-      data_f_w = data_f_w * resp_f_w;
-    }
-    
+    data_f_w = data_f_w * response_array(i, nrows, ncols, nkeep);
     // Do inverse FFT on wire
     data_f_w = Array::idft_cc(data_f_w,1);
-    
     // Add to wire result in frequency
     acc_data_f_w += data_f_w;
   }
   
-  //m_decon_data = Array::array_xxc::Zero(nwires,nsamples);
-  //    if (npad_wire!=0){
-  acc_data_f_w = Array::idft_cc(acc_data_f_w,0);//.block(npad_wire,0,nwires,nsamples);
-  Array::array_xxf real_m_decon_data = acc_data_f_w.real();
-  Array::array_xxf img_m_decon_data = acc_data_f_w.imag().colwise().reverse();
-  m_decon_data = real_m_decon_data + img_m_decon_data;
-  
-  // std::cout << real_m_decon_data(40,5182) << " " << img_m_decon_data(40,5182) << std::endl;
-  //    std::cout << real_m_decon_data(40,5182-m_start_tick) << " " << img_m_decon_data(40,5182-m_start_tick) << std::endl;
-  
-  //}else{
-  // Array::array_xxc temp_m_decon_data = Array::idft_cc(acc_data_f_w,0);
-  //   Array::array_xxf real_m_decon_data = temp_m_decon_data.real();
-  //   Array::array_xxf img_m_decon_data = temp_m_decon_data.imag().rowwise().reverse();
-  //   m_decon_data = real_m_decon_data + img_m_decon_data;
-  // }
-  
-  // // prepare FFT, loop 11 of them ... (older version)
-  // for (size_t i=0;i!=m_vec_vec_charge.size();i++){
-  //   // fill response array in frequency domain
-  //   if (i!=10) continue;
-  
-  //   Array::array_xxc data_f_w;
-  //   {
-  // 	Array::array_xxf data_t_w = Array::array_xxf::Zero(nwires+2*npad_wire,nsamples);
-    // 	// fill charge array in time-wire domain // slightly larger
-    // 	for (size_t j=0;j!=m_vec_vec_charge.at(i).size();j++){
-    // 	  data_t_w(std::get<0>(m_vec_vec_charge.at(i).at(j))+npad_wire,std::get<1>(m_vec_vec_charge.at(i).at(j))) +=  std::get<2>(m_vec_vec_charge.at(i).at(j));
-    // 	}
-    // 	m_vec_vec_charge.at(i).clear();
-	
-    // 	// Do FFT on time
-    // 	data_f_w = Array::dft_rc(data_t_w,0);
-    // 	// Do FFT on wire
-    // 	data_f_w = Array::dft_cc(data_f_w,1);
-    //   }
-      
-    //   {
-    // 	Array::array_xxc resp_f_w = Array::array_xxc::Zero(nwires+2*npad_wire,nsamples);
-    // 	{
-    // 	  Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[0]->spectrum();
-    // 	  for (int icol = 0; icol != nsamples; icol++){
-    // 	    resp_f_w(0,icol) = rs1[icol];
-    // 	  }
-    // 	}
-    // 	for (int irow = 0; irow!=m_num_pad_wire;irow++){
-    // 	  Waveform::compseq_t rs1 = m_vec_map_resp.at(i)[irow+1]->spectrum();
-    // 	  Waveform::compseq_t rs2 = m_vec_map_resp.at(i)[-irow-1]->spectrum();
-    // 	  for (int icol = 0; icol != nsamples; icol++){
-    // 	    resp_f_w(irow+1,icol) = rs1[icol];
-    // 	    resp_f_w(nwires-1-irow+2*npad_wire,icol) = rs2[icol];
-    // 	  }
-    // 	}
-    // 	// Do FFT on wire for response // slight larger
-    // 	resp_f_w = Array::dft_cc(resp_f_w,1); // Now becomes the f and f in both time and wire domain ...
-    // 	// multiply them together
-    // 	data_f_w = data_f_w * resp_f_w;
-    //   }
-      
-    //   // Do inverse FFT on wire
-    //   data_f_w = Array::idft_cc(data_f_w,1);
-      
-    //   // Add to wire result in frequency
-    //   acc_data_f_w += data_f_w;
-    // }
-    // m_vec_vec_charge.clear();
-    
-    // // do inverse FFT on time for the final results ... 
-    
-    // if (npad_wire!=0){
-    //   Array::array_xxf temp_m_decon_data = Array::idft_cr(acc_data_f_w,0);
-    //   m_decon_data = temp_m_decon_data.block(npad_wire,0,nwires,nsamples);
-    // }else{
-    //   m_decon_data = Array::idft_cr(acc_data_f_w,0);
-    // }
-    
-    
-    //    std::cout << m_decon_data(40,5195-m_start_tick)/units::mV << " " << m_decon_data(40,5195-m_start_tick)/units::mV << std::endl;
-    
-  //  m_vec_spmatrix.clear();
-  //m_vec_spmatrix.shrink_to_fit();
-    
-  // int nrows = resp_f_w.rows();
-  // int ncols = resp_f_w.cols();
-  log->debug("ImpactTransform: # of channels: {} # of ticks: {}",
-             m_decon_data.rows(), m_decon_data.cols());
-  
-} // constructor
+  // Back to time.  The imaginary part holds the mirrored groups in
+  // reversed wire order.  Tiles overlap in their padding and add.
+  acc_data_f_w = Array::idft_cc(acc_data_f_w,0);
+  Array::array_xxf real_data = acc_data_f_w.real();
+  Array::array_xxf img_data = acc_data_f_w.imag().colwise().reverse();
+  m_decon_data.block(ch_lo - m_start_ch, tile.tick0 - m_start_tick, nrows, ncols) += real_data + img_data;
+}
+
+void Gen::ImpactTransform::apply_short_response()
+{
+  const int nrows = m_decon_data.rows();
+  const int ncols = m_decon_data.cols();
+  const int nshort = m_short_waveform.size();
+  const int nfft = fft_best_length(ncols + nshort);
+
+  Metrics::instance().peak("ImpactTransform", "short_fft_nticks", nfft);
+
+  // One batch of per wire FFTs in time.
+  Array::array_xxf padded = Array::array_xxf::Zero(nrows, nfft);
+  padded.block(0, 0, nrows, ncols) = m_decon_data;
+  Array::array_xxc data_f = Array::dft_rc(padded, 0);
 
+  Waveform::realseq_t short_wave(nfft, 0);
+  std::copy(m_short_waveform.begin(), m_short_waveform.end(), short_wave.begin());
+  const Waveform::compseq_t short_spec = Waveform::dft(short_wave);
+  for (int icol = 0; icol != nfft; ++icol) {
+    data_f.col(icol) *= short_spec[icol];
+  }
+  m_decon_data = Array::idft_cr(data_f, 0);
+  m_end_tick = m_start_tick + nfft;
+}
 
 
 Gen::ImpactTransform::~ImpactTransform()
@@ -450,41 +612,45 @@ Gen::ImpactTransform::~ImpactTransform()
 Waveform::realseq_t Gen::ImpactTransform::waveform(int iwire) const
 {
   const int nsamples = m_bd.tbins().nbins();
-  if (iwire < m_start_ch || iwire >= m_end_ch){
-    return Waveform::realseq_t(nsamples, 0.0);
-  }else{
-    Waveform::realseq_t wf(nsamples, 0.0);
-    for (int i=0;i!=nsamples;i++){
-      if (i>=m_start_tick && i < m_end_tick){
-	wf.at(i) = m_decon_data(iwire-m_start_ch,i-m_start_tick);
-      }else{
-	//wf.at(i) = 1e-25;
-      }
-      //std::cout << m_decon_data(iwire-m_start_ch,i-m_start_tick) << std::endl;
-    }
-    
-    if (m_pir->closest(0)->long_aux_waveform().size()>0){
-      // now convolute with the long-range response ...
-      const size_t nlength = fft_best_length(nsamples + m_pir->closest(0)->long_aux_waveform_pad());
-      
-      //nlength = nsamples;
-      
-      //   std::cout << nlength << " " << nsamples + m_pir->closest(0)->long_aux_waveform_pad() << std::endl;
-      
-      wf.resize(nlength,0);
-      Waveform::realseq_t long_resp = m_pir->closest(0)->long_aux_waveform();
-      long_resp.resize(nlength,0);
-      Waveform::compseq_t spec = Waveform::dft(wf);
-      Waveform::compseq_t long_spec = Waveform::dft(long_resp);
-      for (size_t i=0;i!=nlength;i++){
-	spec.at(i) *= long_spec.at(i);
-      }
-      wf = Waveform::idft(spec);
-      wf.resize(nsamples,0);
+  Waveform::realseq_t wf(nsamples, 0.0);
+  add_waveform(iwire, wf);
+  return wf;
+}
+
+void Gen::ImpactTransform::add_waveform(int iwire, Waveform::realseq_t& wave) const
+{
+  const int nsamples = m_bd.tbins().nbins();
+  if (!covers(iwire)) {
+    return;
+  }
+  const int row = iwire-m_start_ch;
+  const int tick0 = std::max(0, m_start_tick);
+  const int tick1 = std::min(nsamples, m_end_tick);
+
+  const auto& long_aux = m_pir->closest(0)->long_aux_waveform();
+  if (long_aux.empty()) {
+    // Add straight from the dense result.
+    for (int i=tick0; i<tick1; ++i) {
+      wave[i] += m_decon_data(row, i-m_start_tick);
     }
-    
-    return wf;
+    return;
   }
 
+  // now convolute with the long-range response ...
+  const size_t nlength = fft_best_length(nsamples + m_pir->closest(0)->long_aux_waveform_pad());
+  Waveform::realseq_t wf(nlength, 0.0);
+  for (int i=tick0; i<tick1; ++i) {
+    wf[i] = m_decon_data(row, i-m_start_tick);
+  }
+  Waveform::realseq_t long_resp = long_aux;
+  long_resp.resize(nlength,0);
+  Waveform::compseq_t spec = Waveform::dft(wf);
+  Waveform::compseq_t long_spec = Waveform::dft(long_resp);
+  for (size_t i=0;i!=nlength;i++){
+    spec.at(i) *= long_spec.at(i);
+  }
+  wf = Waveform::idft(spec);
+  for (int i=0; i<nsamples; ++i) {
+    wave[i] += wf[i];
+  }
 }
-
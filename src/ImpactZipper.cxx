@@ -1,16 +1,28 @@
 #include "WireCellGen/ImpactZipper.h"
+#include "WireCellGen/PlaneImpactResponse.h"
+#include "WireCellIface/SimpleTrace.h"
 #include "WireCellUtil/Testing.h"
 
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <thread>
 #include <iostream>             // debugging.
 using namespace std;
 
 using namespace WireCell;
 Gen::ImpactZipper::ImpactZipper(IPlaneImpactResponse::pointer pir, BinnedDiffusion& bd)
-    :m_pir(pir), m_bd(bd)
+    : m_sources{source_t(pir, &bd)}
 {
     
 }
 
+Gen::ImpactZipper::ImpactZipper(const std::vector<source_t>& sources)
+    : m_sources(sources)
+{
+}
+
 
 
 Gen::ImpactZipper::~ImpactZipper()
@@ -20,18 +32,40 @@ Gen::ImpactZipper::~ImpactZipper()
 
 Waveform::realseq_t Gen::ImpactZipper::waveform(int iwire) const
 {
-    const double pitch_range = m_pir->pitch_range();
+    if (m_sources.empty()) {
+        return Waveform::realseq_t();
+    }
+    const int nsamples = m_sources.front().second->tbins().nbins();
+    Waveform::compseq_t total_spectrum(nsamples, Waveform::complex_t(0.0,0.0));
+
+    int nfound=0;
+    for (const auto& source : m_sources) {
+        nfound += add_spectrum(source, iwire, total_spectrum);
+    }
+
+    if (!nfound) {
+        return Waveform::realseq_t(nsamples, 0.0);
+    }
+    
+    auto waveform = Waveform::idft(total_spectrum);
 
-    const auto pimpos = m_bd.pimpos();
+    return waveform;
+}
+
+int Gen::ImpactZipper::add_spectrum(const source_t& source, int iwire, Waveform::compseq_t& total_spectrum) const
+{
+    auto pir = source.first;
+    auto& bd = *source.second;
+    const double pitch_range = pir->pitch_range();
+
+    const auto pimpos = bd.pimpos();
     const auto rb = pimpos.region_binning();
     const auto ib = pimpos.impact_binning();
     const double wire_pos = rb.center(iwire);
 
     const int min_impact = ib.edge_index(wire_pos - 0.5*pitch_range);
     const int max_impact = ib.edge_index(wire_pos + 0.5*pitch_range);
-    const int nsamples = m_bd.tbins().nbins();
-    Waveform::compseq_t total_spectrum(nsamples, Waveform::complex_t(0.0,0.0));
-
+    const int nsamples = bd.tbins().nbins();
 
     int nfound=0;
     const bool share=true;
@@ -42,7 +76,7 @@ Waveform::realseq_t Gen::ImpactZipper::waveform(int iwire) const
     for (int imp = min_impact; imp <= max_impact; ++imp) {
         
         // ImpactData
-        auto id = m_bd.impact_data(imp);
+        auto id = bd.impact_data(imp);
         if (!id) {
             // common as we are scanning all impacts covering a wire
             // fixme: is there a way to predict this to avoid the query?
@@ -71,14 +105,35 @@ Waveform::realseq_t Gen::ImpactZipper::waveform(int iwire) const
 
         Waveform::compseq_t conv_spectrum(nsamples, Waveform::complex_t(0.0,0.0));
         if (share) {            // fixme: make a configurable option
-            TwoImpactResponses two_ir = m_pir->bounded(rel_imp_pos);
+            TwoImpactResponses two_ir = pir->bounded(rel_imp_pos);
             if (!two_ir.first || !two_ir.second) {
                 //std::cerr << "ImpactZipper: no impact response for absolute impact number: " << imp << std::endl;
                 continue;
             }
+            // Compact responses hold only the non-negative
+            // frequencies.  Charge is real so the rest of the product
+            // follows by conjugation.
+            auto g1 = std::dynamic_pointer_cast<Gen::ImpactResponse>(two_ir.first);
+            auto g2 = std::dynamic_pointer_cast<Gen::ImpactResponse>(two_ir.second);
+            if (g1 && g2 && g1->compact() && g2->compact()
+                && g1->nticks() == nsamples && g2->nticks() == nsamples) {
+                const auto& hs1 = g1->half_spectrum();
+                const auto& hs2 = g2->half_spectrum();
+                const int nhalf = hs1.size();
+                for (int ind=0; ind < nhalf; ++ind) {
+                    conv_spectrum[ind] = weightcharge_spectrum[ind]*hs1[ind]+(charge_spectrum[ind]-weightcharge_spectrum[ind])*hs2[ind];
+                }
+                for (int ind=nhalf; ind < nsamples; ++ind) {
+                    conv_spectrum[ind] = std::conj(conv_spectrum[nsamples-ind]);
+                }
+                ++nfound;
+                Waveform::increase(total_spectrum, conv_spectrum);
+                continue;
+            }
+
             // fixme: this is average, not interpolation.
-            Waveform::compseq_t rs1 = two_ir.first->spectrum();            
-            Waveform::compseq_t rs2 = two_ir.second->spectrum();            
+            const Waveform::compseq_t& rs1 = two_ir.first->spectrum();
+            const Waveform::compseq_t& rs2 = two_ir.second->spectrum();
             
             for (int ind=0; ind < nsamples; ++ind) {
                 //conv_spectrum[ind] = complex_one_half*(rs1[ind]+rs2[ind])*charge_spectrum[ind];
@@ -97,7 +152,7 @@ Waveform::realseq_t Gen::ImpactZipper::waveform(int iwire) const
             }
         }
         else {
-            auto ir = m_pir->closest(rel_imp_pos);
+            auto ir = pir->closest(rel_imp_pos);
             if (! ir) {
                 // std::cerr << "ImpactZipper: no impact response for absolute impact number: " << imp << std::endl;
                 continue;
@@ -119,13 +174,145 @@ Waveform::realseq_t Gen::ImpactZipper::waveform(int iwire) const
 
     // Clear memory assuming next call is iwire+1.
     // fixme: this is a dumb way to go. Better to make an iterator.
-    m_bd.erase(0, min_impact); 
+    bd.erase(0, min_impact); 
 
-    if (!nfound) {
-        return Waveform::realseq_t(nsamples, 0.0);
+    return nfound;
+}
+
+
+// Return a trace holding the nonzero span of the wave or nullptr if
+// it is all zero.
+static
+ITrace::pointer wave_to_trace(int chid, const Waveform::realseq_t& wave)
+{
+    auto mm = Waveform::edge(wave);
+    if (mm.first == (int)wave.size()) { // all zero
+        return nullptr;
     }
-    
-    auto waveform = Waveform::idft(total_spectrum);
+    ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
+    return make_shared<SimpleTrace>(chid, mm.first, charge);
+}
 
-    return waveform;
+// Gen::ImpactResponse is safe to share between threads but other
+// implementations may calculate spectra lazily.  Touch each of those
+// here so that zipping threads only ever read them.
+static
+void prime_spectra(IPlaneImpactResponse::pointer pir)
+{
+    const double step = pir->impact();
+    const int nimps = std::round(0.5*pir->pitch_range()/step);
+    for (int ind = -nimps; ind <= nimps; ++ind) {
+        auto ir = pir->closest(ind*step);
+        if (ir && !std::dynamic_pointer_cast<Gen::ImpactResponse>(ir)) {
+            ir->spectrum();
+        }
+    }
+}
+
+ITrace::vector Gen::zip_plane(IPlaneImpactResponse::pointer pir,
+                              BinnedDiffusion& bd,
+                              const IWire::vector& wires,
+                              int nthreads, int nshards)
+{
+    ITrace::vector traces;
+
+    const auto rb = bd.pimpos().region_binning();
+    const int nwires = rb.nbins();
+
+    if (nthreads <= 1) {
+        Gen::ImpactZipper zipper(pir, bd);
+        for (int iwire=0; iwire<nwires; ++iwire) {
+            auto trace = wave_to_trace(wires[iwire]->channel(), zipper.waveform(iwire));
+            if (trace) {
+                traces.push_back(trace);
+            }
+        }
+        return traces;
+    }
+
+    if (nshards <= 0) {
+        nshards = 4*nthreads;
+    }
+    nshards = std::max(1, std::min(nshards, nwires));
+    nthreads = std::min(nthreads, nshards);
+
+    bd.sample_all();
+    prime_spectra(pir);
+
+    const auto ib = bd.pimpos().impact_binning();
+    const double halo = 0.5*pir->pitch_range();
+
+    std::vector<ITrace::vector> shard_traces(nshards);
+    std::atomic<int> next_shard(0);
+    std::exception_ptr error = nullptr;
+    std::mutex error_mutex;
+
+    auto worker = [&]() {
+        try {
+            while (true) {
+                const int ishard = next_shard++;
+                if (ishard >= nshards) {
+                    return;
+                }
+                const int wire_beg = (ishard*nwires)/nshards;
+                const int wire_end = ((ishard+1)*nwires)/nshards;
+
+                // Same impact window as ImpactZipper::waveform() uses.
+                const int imp_beg = ib.edge_index(rb.center(wire_beg) - halo);
+                const int imp_end = ib.edge_index(rb.center(wire_end-1) + halo) + 1;
+                auto sub = bd.subset(imp_beg, imp_end);
+
+                Gen::ImpactZipper zipper(pir, *sub);
+                auto& out = shard_traces[ishard];
+                for (int iwire=wire_beg; iwire<wire_end; ++iwire) {
+                    auto trace = wave_to_trace(wires[iwire]->channel(), zipper.waveform(iwire));
+                    if (trace) {
+                        out.push_back(trace);
+                    }
+                }
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            next_shard = nshards; // let the others stop early
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int ind=0; ind<nthreads; ++ind) {
+        threads.emplace_back(worker);
+    }
+    for (auto& th : threads) {
+        th.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    for (auto& st : shard_traces) {
+        traces.insert(traces.end(), st.begin(), st.end());
+    }
+    return traces;
+}
+
+ITrace::vector Gen::zip_plane(const std::vector<ImpactZipper::source_t>& sources,
+                              const IWire::vector& wires)
+{
+    ITrace::vector traces;
+    if (sources.empty()) {
+        return traces;
+    }
+    const int nwires = sources.front().second->pimpos().region_binning().nbins();
+
+    Gen::ImpactZipper zipper(sources);
+    for (int iwire=0; iwire<nwires; ++iwire) {
+        auto trace = wave_to_trace(wires[iwire]->channel(), zipper.waveform(iwire));
+        if (trace) {
+            traces.push_back(trace);
+        }
+    }
+    return traces;
 }
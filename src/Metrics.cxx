@@ -0,0 +1,123 @@
+#include "WireCellGen/Metrics.h"
+
+#include <ctime>
+
+using namespace WireCell;
+
+Gen::Metrics& Gen::Metrics::instance()
+{
+    static Metrics metrics;
+    return metrics;
+}
+
+Gen::Metrics::Metrics()
+    : m_enabled(false)
+{
+}
+
+void Gen::Metrics::call(const std::string& stage, double wall, double cpu)
+{
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& st = m_stages[stage];
+    ++st.calls;
+    st.wall += wall;
+    st.cpu += cpu;
+}
+
+void Gen::Metrics::count(const std::string& stage, const std::string& name, double value)
+{
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stages[stage].counts[name] += value;
+}
+
+void Gen::Metrics::peak(const std::string& stage, const std::string& name, double value)
+{
+    if (!enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& peaks = m_stages[stage].peaks;
+    auto it = peaks.find(name);
+    if (it == peaks.end()) {
+        peaks[name] = value;
+    }
+    else if (value > it->second) {
+        it->second = value;
+    }
+}
+
+Configuration Gen::Metrics::json_locked() const
+{
+    Configuration ret(Json::objectValue);
+    for (const auto& sit : m_stages) {
+        const auto& st = sit.second;
+        Configuration jst;
+        jst["calls"] = (Json::UInt64)st.calls;
+        jst["wall"] = st.wall;
+        jst["cpu"] = st.cpu;
+        for (const auto& it : st.counts) {
+            jst["counts"][it.first] = it.second;
+        }
+        for (const auto& it : st.peaks) {
+            jst["peaks"][it.first] = it.second;
+        }
+        ret[sit.first] = jst;
+    }
+    return ret;
+}
+
+Configuration Gen::Metrics::json() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return json_locked();
+}
+
+void Gen::Metrics::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stages.clear();
+}
+
+Configuration Gen::Metrics::take()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto ret = json_locked();
+    m_stages.clear();
+    return ret;
+}
+
+
+double Gen::MetricsTimer::thread_cpu()
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return std::clock() / (double)CLOCKS_PER_SEC;
+    }
+    return ts.tv_sec + 1e-9*ts.tv_nsec;
+}
+
+Gen::MetricsTimer::MetricsTimer(const std::string& stage)
+    : m_stage(stage)
+    , m_enabled(Metrics::instance().enabled())
+    , m_cpu0(0)
+{
+    if (m_enabled) {
+        m_wall0 = std::chrono::steady_clock::now();
+        m_cpu0 = thread_cpu();
+    }
+}
+
+Gen::MetricsTimer::~MetricsTimer()
+{
+    if (!m_enabled) {
+        return;
+    }
+    const double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_wall0).count();
+    Metrics::instance().call(m_stage, wall, thread_cpu() - m_cpu0);
+}
@@ -2,9 +2,14 @@
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Response.h"
 #include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/Array.h"
 #include "WireCellIface/SimpleFrame.h"
 #include "WireCellIface/SimpleTrace.h"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 WIRECELL_FACTORY(Misconfigure, WireCell::Gen::Misconfigure,
                  WireCell::IFrameFilter, WireCell::IConfigurable)
 
@@ -62,6 +67,24 @@ void Gen::Misconfigure::configure(const WireCell::Configuration& cfg)
                                 cfg["to"]["shaping"].asDouble()).generate(bins);
 
     m_truncate = cfg["truncate"].asBool();
+    m_ratio.clear();
+}
+
+const Waveform::compseq_t& Gen::Misconfigure::ratio_spectrum(size_t size)
+{
+    auto it = m_ratio.find(size);
+    if (it != m_ratio.end()) {
+        return it->second;
+    }
+    Waveform::realseq_t to(m_to), from(m_from);
+    to.resize(size, 0);
+    from.resize(size, 0);
+    auto spec = Waveform::dft(to);
+    const auto from_spec = Waveform::dft(from);
+    for (size_t ind=0; ind<size; ++ind) {
+        spec[ind] /= from_spec[ind];
+    }
+    return m_ratio[size] = spec;
 }
 
 bool Gen::Misconfigure::operator()(const input_pointer& in, output_pointer& out)
@@ -79,12 +102,44 @@ bool Gen::Misconfigure::operator()(const input_pointer& in, output_pointer& out)
 
     size_t ntraces = traces->size();
     ITrace::vector out_traces(ntraces);
+
+    // Group traces by the FFT length which, as in
+    // Waveform::replace_convolve(), avoids wrap around.
+    const size_t nresp = std::max(m_to.size(), m_from.size());
+    std::map<size_t, std::vector<size_t> > bysize;
     for (size_t ind=0; ind<ntraces; ++ind) {
-        auto trace = traces->at(ind);
+        const size_t nwave = traces->at(ind)->charge().size();
+        bysize[std::max(nresp, nwave + m_to.size() - 1)].push_back(ind);
+    }
 
-        auto wave = Waveform::replace_convolve(trace->charge(),
-                                               m_to, m_from, m_truncate);
-        out_traces[ind] = std::make_shared<SimpleTrace>(trace->channel(), trace->tbin(), wave);
+    for (const auto& group : bysize) {
+        const size_t size = group.first;
+        const auto& inds = group.second;
+        const int nrows = inds.size();
+
+        Array::array_xxf arr = Array::array_xxf::Zero(nrows, size);
+        for (int row=0; row<nrows; ++row) {
+            const auto& charge = traces->at(inds[row])->charge();
+            for (size_t col=0; col<charge.size(); ++col) {
+                arr(row, col) = charge[col];
+            }
+        }
+        Array::array_xxc spec = Array::dft_rc(arr, 0);
+        const auto& ratio = ratio_spectrum(size);
+        for (size_t col=0; col<size; ++col) {
+            spec.col(col) *= ratio[col];
+        }
+        arr = Array::idft_cr(spec, 0);
+
+        for (int row=0; row<nrows; ++row) {
+            auto trace = traces->at(inds[row]);
+            const size_t nout = m_truncate ? trace->charge().size() : size;
+            Waveform::realseq_t wave(nout);
+            for (size_t col=0; col<nout; ++col) {
+                wave[col] = arr(row, col);
+            }
+            out_traces[inds[row]] = std::make_shared<SimpleTrace>(trace->channel(), trace->tbin(), wave);
+        }
     }
 
     out = std::make_shared<SimpleFrame>(in->ident(), in->time(), out_traces, in->tick());
@@ -0,0 +1,140 @@
+#include "WireCellGen/MultiDepoMerger.h"
+
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/Exceptions.h"
+
+WIRECELL_FACTORY(MultiDepoMerger, WireCell::Gen::MultiDepoMerger,
+                 WireCell::INode, WireCell::IConfigurable)
+
+
+using namespace WireCell;
+
+Gen::MultiDepoMerger::MultiDepoMerger(size_t multiplicity)
+    : m_multiplicity(multiplicity)
+    , m_loaded(multiplicity, false)
+    , m_done(multiplicity, false)
+    , m_ndone(0)
+    , m_nin(multiplicity, 0)
+    , m_nout(0)
+    , m_eos(false)
+    , log(Log::logger("glue"))
+{
+}
+Gen::MultiDepoMerger::~MultiDepoMerger()
+{
+}
+
+WireCell::Configuration Gen::MultiDepoMerger::default_configuration() const
+{
+    Configuration cfg;
+    /// Number of input depo streams.
+    cfg["multiplicity"] = (int)m_multiplicity;
+    return cfg;
+}
+
+void Gen::MultiDepoMerger::configure(const WireCell::Configuration& cfg)
+{
+    int m = get<int>(cfg, "multiplicity", (int)m_multiplicity);
+    if (m<=0) {
+        log->critical("MultiDepoMerger multiplicity must be positive");
+        THROW(ValueError() << errmsg{"MultiDepoMerger multiplicity must be positive"});
+    }
+    m_multiplicity = m;
+    m_heads = decltype(m_heads)();
+    m_loaded.assign(m, false);
+    m_done.assign(m, false);
+    m_ndone = 0;
+    m_nin.assign(m, 0);
+    m_nout = 0;
+    m_eos = false;
+}
+
+std::string Gen::MultiDepoMerger::signature()
+{
+    return typeid(MultiDepoMerger).name();
+}
+
+std::vector<std::string> Gen::MultiDepoMerger::input_types()
+{
+    const std::string tname = std::string(typeid(IDepo).name());
+    std::vector<std::string> ret(m_multiplicity, tname);
+    return ret;
+}
+
+std::vector<std::string> Gen::MultiDepoMerger::output_types()
+{
+    return std::vector<std::string>{std::string(typeid(IDepo).name())};
+}
+
+void Gen::MultiDepoMerger::load(size_t port, any_queue_type& inq)
+{
+    if (m_loaded[port] or m_done[port] or inq.empty()) {
+        return;
+    }
+    auto depo = boost::any_cast<IDepo::pointer>(inq.front());
+    if (!depo) {
+        inq.pop_front();
+        m_done[port] = true;
+        ++m_ndone;
+        return;
+    }
+    m_heads.push(head_t(depo->time(), port));
+    m_loaded[port] = true;
+}
+
+bool Gen::MultiDepoMerger::operator()(any_queue_vector& inqs,
+                                      any_queue_vector& outqs)
+{
+    if (m_eos) {                // already closed off all our outputs
+        return false;
+    }
+    if (inqs.size() != m_multiplicity) {
+        log->error("MultiDepoMerger: expect {} input queues, got {}",
+                   m_multiplicity, inqs.size());
+        return false;
+    }
+    outqs.resize(1);
+    auto& outq = outqs[0];
+
+    size_t nwaiting = 0;
+    for (size_t port=0; port<m_multiplicity; ++port) {
+        load(port, inqs[port]);
+        if (!m_loaded[port] and !m_done[port]) {
+            ++nwaiting;
+        }
+    }
+
+    const size_t nout_before = m_nout;
+
+    // Output the earliest head for as long as every live port has a
+    // head to compare against.
+    while (!nwaiting and !m_heads.empty()) {
+        const size_t port = m_heads.top().second;
+        m_heads.pop();
+        m_loaded[port] = false;
+
+        auto& inq = inqs[port];
+        outq.push_back(inq.front());
+        inq.pop_front();
+        ++m_nin[port];
+        ++m_nout;
+
+        load(port, inq);
+        if (!m_loaded[port] and !m_done[port]) {
+            ++nwaiting;
+        }
+    }
+
+    if (m_ndone == m_multiplicity) {
+        m_eos = true;
+        outq.push_back(IDepo::pointer(nullptr));
+        std::string nins;
+        for (auto n : m_nin) {
+            nins += " " + std::to_string(n);
+        }
+        log->debug("MultiDepoMerger: global EOS: in:{}, out: {} depos", nins, m_nout);
+        return true;
+    }
+
+    return m_nout > nout_before;
+}
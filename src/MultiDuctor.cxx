@@ -1,15 +1,19 @@
 #include "WireCellGen/MultiDuctor.h"
+#include "WireCellGen/BinnedDiffusion.h"
+#include "WireCellGen/ImpactZipper.h"
+#include "WireCellGen/Metrics.h"
 
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Pimpos.h"
 #include "WireCellUtil/Binning.h"
 #include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/Waveform.h"
 
-// fixme: this needs to move out of iface!
-#include "WireCellIface/FrameTools.h"
 #include "WireCellIface/SimpleFrame.h"
 #include "WireCellIface/SimpleTrace.h"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 WIRECELL_FACTORY(MultiDuctor, WireCell::Gen::MultiDuctor,
@@ -25,6 +29,10 @@ Gen::MultiDuctor::MultiDuctor(const std::string anode)
     , m_frame_count(0)
     , m_continuous(false)
     , m_eos(true)
+    , m_ring_head(0)
+    , m_tail_time(-1.0)
+    , m_tail_ticks(0)
+    , m_single_pass(false)
 {
 }
 Gen::MultiDuctor::~MultiDuctor()
@@ -65,6 +73,18 @@ WireCell::Configuration Gen::MultiDuctor::default_configuration() const
 
     /// Allow for a custom starting frame number
     cfg["first_frame_number"] = m_frame_count;
+
+    /// The time past the end of a readout for which sub ductor
+    /// samples are summed in place.  Later samples are held aside
+    /// until a later readout.  If negative, the longest response of
+    /// the sub ductors of type Ductor is used.
+    cfg["tail_time"] = m_tail_time;
+
+    /// If true, the sub ductors must be of type Ductor and each plane
+    /// is simulated once for all of them instead of once per sub
+    /// ductor.  The sub ductors' response, rng, nsigma and
+    /// drift_speed are used but their time parameters are not.
+    cfg["single_pass"] = m_single_pass;
      
     return cfg;
 }
@@ -130,6 +150,14 @@ void Gen::MultiDuctor::configure(const WireCell::Configuration& cfg)
     m_start_time = get<double>(cfg, "start_time", m_start_time);
     m_frame_count = get<int>(cfg, "first_frame_number", m_frame_count);
     m_continuous = get(cfg, "continuous", m_continuous);
+    m_single_pass = get(cfg, "single_pass", m_single_pass);
+    m_tail_time = get(cfg, "tail_time", m_tail_time);
+    m_rows.clear();
+    m_spill.clear();
+    m_ring_head = 0;
+    m_tail_ticks = 0;
+    m_sp_ductors.clear();
+    m_sp_depos.clear();
 
     m_anode_tn = get(cfg, "anode", m_anode_tn);
     m_anode = Factory::find_tn<IAnodePlane>(m_anode_tn);
@@ -176,16 +204,49 @@ void Gen::MultiDuctor::configure(const WireCell::Configuration& cfg)
             if (!ductor) {
                 THROW(KeyError() << errmsg{"Failed to find (sub) Ductor: " + ductor_tn});
             }
+            size_t index = 0;
+            if (m_single_pass) {
+                auto gd = std::dynamic_pointer_cast<Gen::Ductor>(ductor);
+                if (!gd) {
+                    THROW(ValueError() << errmsg{"single pass MultiDuctor needs a Ductor, got: " + ductor_tn});
+                }
+                index = std::find(m_sp_ductors.begin(), m_sp_ductors.end(), gd) - m_sp_ductors.begin();
+                if (index == m_sp_ductors.size()) {
+                    m_sp_ductors.push_back(gd);
+                }
+            }
             auto jargs = jrule["args"];
             if (rule == "wirebounds") {
-                dchain.push_back(SubDuctor(ductor_tn, Wirebounds(pimpos, jargs), ductor));
+                dchain.push_back(SubDuctor(ductor_tn, Wirebounds(pimpos, jargs), ductor, index));
             }
             if (rule == "bool") {
-                dchain.push_back(SubDuctor(ductor_tn, ReturnBool(jargs), ductor));
+                dchain.push_back(SubDuctor(ductor_tn, ReturnBool(jargs), ductor, index));
             }
         }
         m_chains.push_back(dchain);
     } // loop to store chains of ductors
+    m_sp_depos.resize(m_sp_ductors.size());
+
+    if (m_tail_time >= 0) {
+        m_tail_ticks = std::round(m_tail_time/m_tick);
+    }
+    else {
+        // As DepoTransform, reach of the short plus long response.
+        for (auto& chain : m_chains) {
+            for (auto& sd : chain) {
+                auto gd = std::dynamic_pointer_cast<Gen::Ductor>(sd.ductor);
+                if (!gd) {
+                    continue;
+                }
+                for (auto pir : gd->pirs()) {
+                    auto ir = pir->closest(0);
+                    if (ir) {
+                        m_tail_ticks = std::max(m_tail_ticks, ir->waveform_pad() + ir->long_aux_waveform_pad());
+                    }
+                }
+            }
+        }
+    }
 }
 
 // void Gen::MultiDuctor::reset()
@@ -218,22 +279,28 @@ bool Gen::MultiDuctor::start_processing(const input_pointer& depo)
 }
 
 
-void Gen::MultiDuctor::dump_frame(const IFrame::pointer frame, std::string msg)
+int Gen::MultiDuctor::readout_ticks() const
 {
-    auto traces = frame->traces();
-    if (!traces or traces->empty()) {
-        std::cerr << msg
-                  << " fid:" << frame->ident()
-                  << " has no traces\n";
-        return;
+    return std::round(m_readout_time/m_tick);
+}
+
+std::vector<IRandom::pointer> Gen::MultiDuctor::rngs() const
+{
+    std::vector<IRandom::pointer> ret;
+    for (const auto& chain : m_chains) {
+        for (const auto& sd : chain) {
+            auto gd = std::dynamic_pointer_cast<Gen::Ductor>(sd.ductor);
+            if (gd and gd->rng()) {
+                ret.push_back(gd->rng());
+            }
+        }
     }
+    return ret;
+}
 
-    auto mm = FrameTools::tbin_range(*traces);
-    std::cerr << msg
-              << " fid:" << frame->ident()
-              << " #ch:" << traces->size()
-              << " t:" << std::setprecision(12) << m_start_time/units::us<<"us "
-              << " tbins:["<<mm.first<<","<<mm.second<<"]\n";
+int Gen::MultiDuctor::ring_ticks() const
+{
+    return readout_ticks() + m_tail_ticks;
 }
 
 // Outframes should not get a terminating nullptr even if depo is nullptr
@@ -248,47 +315,69 @@ void Gen::MultiDuctor::maybe_extract(const input_pointer& depo, output_queue& ou
         for (auto& sd : chain) {
             output_queue newframes;
             (*sd.ductor)(nullptr, newframes); // flush with EOS marker
-            merge(newframes);   // updates frame buffer
+            merge(newframes);   // adds to the ring
         }
     }
 
-    // we must read out, and yet we have nothing
-    //
-    // fixme: the default behavior of this is to make sequential
-    // blocks of m_readout_time even if there be no data.  Need to
-    // also handle a more isolated running where the readout window is
-    // data driven up until EOS is found.
-    if (!m_frame_buffer.size()) {
-
-        std::cerr << "MultiDuctor: returning empty frame with "<<m_frame_count
-                  << " at " << m_start_time << "\n";
-
-        ITrace::vector traces;
-        auto frame = std::make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
-        outframes.push_back(frame);
-
-        m_start_time += m_readout_time;
-        ++m_frame_count;
-        return;
+    // Take the readout out of the ring.  The ring slots are zeroed
+    // as they are read so they may be reused for later ticks.
+    auto& metrics = Metrics::instance();
+    const int nticks = readout_ticks();
+    const int nring = ring_ticks();
+    ITrace::vector traces;
+    for (auto it = m_rows.begin(); it != m_rows.end();) {
+        auto& row = it->second;
+        ITrace::ChargeSequence charge(nticks, 0.0);
+        for (int itick=0; itick<nticks && itick<=row.last; ++itick) {
+            float& slot = row.ring[(m_ring_head + itick) % nring];
+            charge[itick] = slot;
+            slot = 0.0;
+        }
+        auto mm = Waveform::edge(charge);
+        if (mm.first < (int)charge.size()) {
+            ITrace::ChargeSequence span(charge.begin()+mm.first, charge.begin()+mm.second);
+            traces.push_back(std::make_shared<SimpleTrace>(it->first, mm.first, span));
+        }
+        row.last -= nticks;
+        if (row.last < 0) {
+            it = m_rows.erase(it);
+        }
+        else {
+            ++it;
+        }
     }
+    m_ring_head = (m_ring_head + nticks) % nring;
+
+    // Bring spilled samples which now fall in the ring into it.
+    std::vector<Spill> spill;
+    spill.swap(m_spill);
+    size_t nlate = 0;
+    for (const auto& sp : spill) {
+        nlate += add_samples(sp.channel, sp.tbin - nticks, sp.charge);
+    }
+    metrics.count("MultiDuctor", "samples_late", nlate);
 
+    if (traces.empty()) {
+        metrics.count("MultiDuctor", "empty_frames");
+    }
+    metrics.count("MultiDuctor", "frames_out");
+    metrics.count("MultiDuctor", "traces_out", traces.size());
 
-    // At this point the m_frame_buffer has at least some frames from
-    // multiple sub-ductors, each of different time and channel extent
-    // and potentially out of order.
-
+    auto frame = std::make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
+    outframes.push_back(frame);
+    m_start_time += m_readout_time;
+    ++m_frame_count;
+}
 
-    const double target_time = m_start_time + m_readout_time;
-    output_queue to_keep, to_extract;
-    for (auto frame: m_frame_buffer) {
-        if (!frame) {
-            std::cerr << "Gen::MultiDuctor: skipping null frame in frame buffer\n";
-            continue;
-        }
-        if (!frame->traces()) {
-            std::cerr << "Gen::MultiDuctor: skipping empty frame in frame buffer\n";
-            continue;
-        }   
+void Gen::MultiDuctor::merge(const output_queue& newframes)
+{
+    auto& metrics = Metrics::instance();
+    const int nring = ring_ticks();
+    for (auto frame : newframes) {
+        if (!frame) { continue; } // skip internal EOS
+        auto traces = frame->traces();
+        if (!traces) { continue; }
+        if (traces->empty()) { continue; }
 
         {
             const double tick = frame->tick();
@@ -299,118 +388,135 @@ void Gen::MultiDuctor::maybe_extract(const input_pointer& depo, output_queue& ou
             }
         }
 
-        int cmp = FrameTools::frmtcmp(frame, target_time);
-        // std::cerr << "Gen::MultiDuctor: checking to keep: "
-        //           << std::setprecision(12)
-        //           << "t_target=" << target_time/units::us << "us, "
-        //           << "cmp returns " << cmp << ", frame is:\n";
-        // dump_frame(frame, "\t");
+        // Ticks are relative to the start of the current readout.
+        const int offset = std::round((frame->time() - m_start_time)/m_tick);
+        size_t nlate = 0;
+        for (auto trace : *traces) {
+            nlate += add_samples(trace->channel(), trace->tbin() + offset, trace->charge());
+        }
+        metrics.count("MultiDuctor", "frames_in");
+        metrics.count("MultiDuctor", "traces_in", traces->size());
+        metrics.count("MultiDuctor", "samples_late", nlate);
+    }
+}
 
-        if (cmp < 0) {
-            to_extract.push_back(frame);
+size_t Gen::MultiDuctor::add_samples(int channel, int tbin, const std::vector<float>& charge)
+{
+    const int nring = ring_ticks();
+    size_t nlate = 0;
+    RingRow* row = nullptr;
+    for (size_t ind=0; ind<charge.size(); ++ind) {
+        const int itick = tbin + ind;
+        if (itick < 0) {
+            ++nlate;
             continue;
         }
-        if (cmp > 0) {
-            to_keep.push_back(frame);
-            continue;
-        }                
-
-        // If cmp==0 above then both halves of the pair should hold a frame.
-        auto ff = FrameTools::split(frame, target_time);
-        if (ff.first) {
-            to_extract.push_back(ff.first);
-            //dump_frame(ff.first, "Gen::MultiDuctor: to extract");
+        if (itick >= nring) {
+            // Keep the rest for a later readout.
+            m_spill.push_back(Spill{channel, itick, std::vector<float>(charge.begin()+ind, charge.end())});
+            Metrics::instance().count("MultiDuctor", "samples_spilled", charge.size()-ind);
+            break;
         }
-        else {
-            std::cerr << "Gen::MultiDuctor: error: early split is null\n";
+        if (!row) {
+            row = &m_rows[channel];
+            if (row->ring.empty()) {
+                row->ring.resize(nring, 0.0);
+                row->last = -1;
+            }
         }
+        row->ring[(m_ring_head + itick) % nring] += charge[ind];
+        row->last = std::max(row->last, itick);
+    }
+    return nlate;
+}
+
+void Gen::MultiDuctor::process_single_pass(output_queue& outframes)
+{
+    ITrace::vector traces;
+    Binning tbins(m_readout_time/m_tick, m_start_time, m_start_time+m_readout_time);
+    const size_t nsubs = m_sp_ductors.size();
 
-        if (ff.second) {
-            to_keep.push_back(ff.second);
-            //dump_frame(ff.second, "Gen::MultiDuctor: to keep");
+    for (auto face : m_anode->faces()) {
+        auto bb = face->sensitive();
+        if (bb.empty()) {
+            continue;
         }
-        else {
-            std::cerr << "Gen::MultiDuctor: error: late split is null\n";
+        std::vector<IDepo::vector> face_depos(nsubs);
+        for (size_t isub=0; isub<nsubs; ++isub) {
+            for (auto depo : m_sp_depos[isub]) {
+                if (bb.inside(depo->pos())) {
+                    face_depos[isub].push_back(depo);
+                }
+            }
         }
 
+        int iplane = -1;
+        for (auto plane : face->planes()) {
+            ++iplane;
+            const Pimpos* pimpos = plane->pimpos();
+
+            std::vector<std::unique_ptr<Gen::BinnedDiffusion> > bds;
+            std::vector<Gen::ImpactZipper::source_t> sources;
+            for (size_t isub=0; isub<nsubs; ++isub) {
+                if (face_depos[isub].empty()) {
+                    continue;
+                }
+                auto sd = m_sp_ductors[isub];
+                bds.emplace_back(new Gen::BinnedDiffusion(*pimpos, tbins, sd->nsigma(), sd->rng()));
+                auto& bindiff = *bds.back();
+                for (auto depo : face_depos[isub]) {
+                    bindiff.add(depo, depo->extent_long() / sd->drift_speed(), depo->extent_tran());
+                }
+                sources.push_back(Gen::ImpactZipper::source_t(sd->pirs().at(iplane), &bindiff));
+            }
+            auto newtraces = Gen::zip_plane(sources, plane->wires());
+            traces.insert(traces.end(), newtraces.begin(), newtraces.end());
+        }
     }
-    m_frame_buffer = to_keep;
-    
-    if (!to_extract.size()) {
-        // we read out, and yet we have nothing
-
-        std::cerr << "MultiDuctor: returning empty frame after sub frame sorting with "
-                  << m_frame_count<<" at " << m_start_time << "\n";
-
-        ITrace::vector traces;
-        auto frame = std::make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
-        outframes.push_back(frame);
-        m_start_time += m_readout_time;
-        ++m_frame_count;
-        return;
+    for (auto& depos : m_sp_depos) {
+        depos.clear();
     }
-    
-
-    /// Big fat lazy programmer FIXME: there is a bug waiting to bite
-    /// here.  If somehow a sub-ductor manages to make a frame that
-    /// remains bigger than m_readout_time after the split() above, it
-    /// will cause the final output frame to extend past requested
-    /// duration.  There needs to be a loop over to_extract added.
-
-    /// Big fat lazy programmer FIXME v2: there can be multiple traces
-    /// on the same channel which may overlap in time.
 
-    ITrace::vector traces;
-    for (auto frame: to_extract) {
-        const double tref = frame->time();
-        const int extra_tbins = (tref-m_start_time)/m_tick;
-        for (auto trace : (*frame->traces())) {
-            const int tbin = trace->tbin() + extra_tbins;
-            const int chid = trace->channel();
-            // std::cerr <<traces.size()
-            //           <<" tstart="<<m_start_time/units::us<<"us"
-            //           <<" tref="<<tref/units::us << "us"
-            //           <<" tbin="<<tbin
-            //           <<" extra bins="<< extra_tbins<<" chid="<<chid<<"\n";
-            auto mtrace = std::make_shared<SimpleTrace>(chid, tbin, trace->charge());
-            traces.push_back(mtrace);
-        }
-    }
     auto frame = std::make_shared<SimpleFrame>(m_frame_count, m_start_time, traces, m_tick);
-    dump_frame(frame, "Gen::MultiDuctor: output frame");
-
     outframes.push_back(frame);
     m_start_time += m_readout_time;
     ++m_frame_count;
 }
 
-void Gen::MultiDuctor::merge(const output_queue& newframes)
+bool Gen::MultiDuctor::operator()(const input_pointer& depo, output_queue& outframes)
 {
-    for (auto frame : newframes) {
-        if (!frame) { continue; } // skip internal EOS
-        auto traces = frame->traces();
-        if (!traces) { continue; }
-        if (traces->empty()) { continue; }
-
-        //dump_frame(frame, "Gen::MultiDuctor: merging frame");
-        m_frame_buffer.push_back(frame);
+    if (m_single_pass) {
+        if (start_processing(depo)) {
+            process_single_pass(outframes);
+        }
+        if (!depo) {
+            outframes.push_back(nullptr);
+            return true;
+        }
+        for (auto& chain : m_chains) {
+            for (auto& sd : chain) {
+                if (sd.check(depo)) {
+                    m_sp_depos[sd.index].push_back(depo);
+                    break;
+                }
+            }
+        }
+        return true;
     }
-}
 
-bool Gen::MultiDuctor::operator()(const input_pointer& depo, output_queue& outframes)
-{
     // end of stream processing
     if (!depo) {              
-        //std::cerr << "Gen::MultiDuctor: end of stream processing\n";
         maybe_extract(depo, outframes);
         outframes.push_back(nullptr); // pass on EOS marker
-        if (!m_frame_buffer.empty()) {
-            std::cerr << "Gen::MultiDuctor: purging " << m_frame_buffer.size() << " frames at EOS\n";
-            for (auto frame : m_frame_buffer) {
-                dump_frame(frame, "\t");
-            }
-            m_frame_buffer.clear();
+        if (!m_rows.empty()) {
+            Metrics::instance().count("MultiDuctor", "purged_channels", m_rows.size());
+            m_rows.clear();
+        }
+        if (!m_spill.empty()) {
+            Metrics::instance().count("MultiDuctor", "purged_spills", m_spill.size());
+            m_spill.clear();
         }
+        m_ring_head = 0;
         return true;
     }
 
@@ -440,14 +546,10 @@ bool Gen::MultiDuctor::operator()(const input_pointer& depo, output_queue& outfr
         }
     }
     if (count == 0) {
-        std::cerr << "Gen::MultiDuctor: warning: no appropriate Ductor for depo at: "
-                  << depo->pos() << std::endl;
+        Metrics::instance().count("MultiDuctor", "unmatched_depos");
     }
 
     maybe_extract(depo, outframes);
-    if (outframes.size()) {
-        std::cerr << "Gen::MultiDuctor: returning " << outframes.size() << " frames\n";
-    }
     return true;
 }
 
@@ -2,10 +2,13 @@
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Response.h"
 #include "WireCellUtil/Waveform.h"
+#include "WireCellUtil/Array.h"
 #include "WireCellIface/SimpleFrame.h"
 #include "WireCellIface/SimpleTrace.h"
 
+#include <algorithm>
 #include <string>
+#include <vector>
 
 WIRECELL_FACTORY(PerChannelVariation, WireCell::Gen::PerChannelVariation,
                  WireCell::IFrameFilter, WireCell::IConfigurable)
@@ -13,6 +16,9 @@ WIRECELL_FACTORY(PerChannelVariation, WireCell::Gen::PerChannelVariation,
 using namespace WireCell;
 
 Gen::PerChannelVariation::PerChannelVariation()
+    : m_nsamples(0)
+    , m_truncate(true)
+    , m_cache_spectra(false)
 {
 }
 
@@ -45,6 +51,11 @@ WireCell::Configuration Gen::PerChannelVariation::default_configuration() const
 
     /// ch-by-ch electronics responses by calibration
     cfg["per_chan_resp"] = "";
+
+    /// If true, keep the ratio spectrum of each channel for each
+    /// trace length seen.  This saves one FFT per trace at the cost
+    /// of memory of about 8 bytes per sample per channel per length.
+    cfg["cache_spectra"] = false;
    
     return cfg;
 }
@@ -68,6 +79,33 @@ void Gen::PerChannelVariation::configure(const WireCell::Configuration& cfg)
     }
 
     m_truncate = cfg["truncate"].asBool();
+    m_cache_spectra = get<bool>(cfg, "cache_spectra", false);
+    m_responses.clear();
+    m_from_spectra.clear();
+    m_ratio.clear();
+}
+
+const Waveform::realseq_t& Gen::PerChannelVariation::channel_response(int chid)
+{
+    auto it = m_responses.find(chid);
+    if (it != m_responses.end()) {
+        return it->second;
+    }
+    auto& resp = m_responses[chid];
+    resp = m_cr->channel_response(chid);
+    resp.resize(m_nsamples, 0);
+    return resp;
+}
+
+const Waveform::compseq_t& Gen::PerChannelVariation::from_spectrum(size_t size)
+{
+    auto it = m_from_spectra.find(size);
+    if (it != m_from_spectra.end()) {
+        return it->second;
+    }
+    Waveform::realseq_t from(m_from);
+    from.resize(size, 0);
+    return m_from_spectra[size] = Waveform::dft(from);
 }
 
 bool Gen::PerChannelVariation::operator()(const input_pointer& in, output_pointer& out)
@@ -92,14 +130,76 @@ bool Gen::PerChannelVariation::operator()(const input_pointer& in, output_pointe
 
     size_t ntraces = traces->size();
     ITrace::vector out_traces(ntraces);
+
+    // Group traces by the FFT length which, as in
+    // Waveform::replace_convolve(), avoids wrap around.
+    const size_t nresp = std::max((size_t)m_nsamples, m_from.size());
+    std::map<size_t, std::vector<size_t> > bysize;
     for (size_t ind=0; ind<ntraces; ++ind) {
-        auto trace = traces->at(ind);
-        auto chid = trace->channel();
-        Waveform::realseq_t tch_resp = m_cr->channel_response(chid);
-        tch_resp.resize(m_nsamples, 0);
-        auto wave = Waveform::replace_convolve(trace->charge(),
-                                               tch_resp, m_from, m_truncate);
-        out_traces[ind] = std::make_shared<SimpleTrace>(chid, trace->tbin(), wave);
+        const size_t nwave = traces->at(ind)->charge().size();
+        bysize[std::max(nresp, nwave + m_nsamples - 1)].push_back(ind);
+    }
+
+    for (const auto& group : bysize) {
+        const size_t size = group.first;
+        const auto& inds = group.second;
+        const int nrows = inds.size();
+        const auto& from_spec = from_spectrum(size);
+
+        Array::array_xxf arr = Array::array_xxf::Zero(nrows, size);
+        for (int row=0; row<nrows; ++row) {
+            const auto& charge = traces->at(inds[row])->charge();
+            for (size_t col=0; col<charge.size(); ++col) {
+                arr(row, col) = charge[col];
+            }
+        }
+        Array::array_xxc spec = Array::dft_rc(arr, 0);
+
+        if (m_cache_spectra) {
+            for (int row=0; row<nrows; ++row) {
+                const int chid = traces->at(inds[row])->channel();
+                auto key = std::make_pair(chid, size);
+                auto it = m_ratio.find(key);
+                if (it == m_ratio.end()) {
+                    Waveform::realseq_t resp = channel_response(chid);
+                    resp.resize(size, 0);
+                    auto ratio = Waveform::dft(resp);
+                    for (size_t col=0; col<size; ++col) {
+                        ratio[col] /= from_spec[col];
+                    }
+                    it = m_ratio.emplace(key, ratio).first;
+                }
+                const auto& ratio = it->second;
+                for (size_t col=0; col<size; ++col) {
+                    spec(row, col) *= ratio[col];
+                }
+            }
+        }
+        else {
+            // Transform the responses in one batch, too.
+            Array::array_xxf resp_arr = Array::array_xxf::Zero(nrows, size);
+            for (int row=0; row<nrows; ++row) {
+                const auto& resp = channel_response(traces->at(inds[row])->channel());
+                for (size_t col=0; col<resp.size(); ++col) {
+                    resp_arr(row, col) = resp[col];
+                }
+            }
+            Array::array_xxc resp_spec = Array::dft_rc(resp_arr, 0);
+            for (size_t col=0; col<size; ++col) {
+                spec.col(col) *= resp_spec.col(col) / from_spec[col];
+            }
+        }
+        arr = Array::idft_cr(spec, 0);
+
+        for (int row=0; row<nrows; ++row) {
+            auto trace = traces->at(inds[row]);
+            const size_t nout = m_truncate ? trace->charge().size() : size;
+            Waveform::realseq_t wave(nout);
+            for (size_t col=0; col<nout; ++col) {
+                wave[col] = arr(row, col);
+            }
+            out_traces[inds[row]] = std::make_shared<SimpleTrace>(trace->channel(), trace->tbin(), wave);
+        }
     }
 
     out = std::make_shared<SimpleFrame>(in->ident(), in->time(), out_traces, in->tick());
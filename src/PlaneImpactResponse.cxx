@@ -4,6 +4,18 @@
 #include "WireCellUtil/Testing.h"
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/FFTBestLength.h"
+#include "WireCellUtil/Persist.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 WIRECELL_FACTORY(PlaneImpactResponse, WireCell::Gen::PlaneImpactResponse,
                  WireCell::IPlaneImpactResponse, WireCell::IConfigurable)
@@ -13,22 +25,119 @@ using namespace std;
 using namespace WireCell;
 
 
-const Waveform::compseq_t& Gen::ImpactResponse::spectrum(){
-  if (m_spectrum.size()!=0){
-    return m_spectrum;
-  }else{
-    m_spectrum = Waveform::dft(m_waveform);
-    return m_spectrum;
+// Fill in the negative frequencies of the spectrum of a real
+// waveform of n samples given bins 0 to n/2.
+static
+Waveform::compseq_t expand_half(const Waveform::compseq_t& half, int n)
+{
+  Waveform::compseq_t full(n);
+  std::copy(half.begin(), half.end(), full.begin());
+  for (int ind = half.size(); ind < n; ++ind) {
+    full[ind] = std::conj(full[n-ind]);
+  }
+  return full;
+}
+
+static
+Gen::ImpactResponse::shared_spectrum_t long_spectrum_of(const Waveform::realseq_t& long_wf)
+{
+  if (long_wf.empty()) {
+    return std::make_shared<const Waveform::compseq_t>();
+  }
+  return std::make_shared<const Waveform::compseq_t>(Waveform::dft(long_wf));
+}
+
+Gen::ImpactResponse::ImpactResponse(int impact, const Waveform::realseq_t& wf, int waveform_pad,
+                                    const Waveform::realseq_t& long_wf, int long_waveform_pad,
+                                    const Waveform::realseq_t& field_wf,
+                                    const Waveform::compseq_t& spec)
+  : ImpactResponse(impact, wf, spec, waveform_pad,
+                   std::make_shared<const Waveform::realseq_t>(long_wf), long_spectrum_of(long_wf),
+                   long_waveform_pad, field_wf, false)
+{
+}
+
+Gen::ImpactResponse::ImpactResponse(int impact, const Waveform::realseq_t& wf, const Waveform::compseq_t& spec,
+                                    int waveform_pad,
+                                    shared_waveform_t long_wf, shared_spectrum_t long_spec, int long_waveform_pad,
+                                    const Waveform::realseq_t& field_wf, bool compact)
+  : m_impact(impact)
+  , m_nticks(spec.empty() ? wf.size() : spec.size())
+  , m_compact(compact)
+  , m_waveform_pad(waveform_pad)
+  , m_long_waveform(long_wf), m_long_spectrum(long_spec), m_long_waveform_pad(long_waveform_pad)
+  , m_field_waveform(field_wf)
+{
+  Waveform::compseq_t full = spec;
+  if (full.empty() && !wf.empty()) {
+    full = Waveform::dft(wf);
+  }
+  if (m_compact) {
+    m_half.assign(full.begin(), full.begin() + (m_nticks ? m_nticks/2+1 : 0));
+    return;
+  }
+  m_spectrum.swap(full);
+  m_waveform = wf.empty() ? Waveform::idft(m_spectrum) : wf;
+}
+
+Gen::ImpactResponse::ImpactResponse(int impact, int nticks, Waveform::realseq_t&& wf, Waveform::compseq_t&& half,
+                                    int waveform_pad,
+                                    shared_waveform_t long_wf, shared_spectrum_t long_spec, int long_waveform_pad,
+                                    Waveform::realseq_t&& field_wf, bool compact)
+  : m_impact(impact)
+  , m_nticks(nticks)
+  , m_compact(compact)
+  , m_waveform_pad(waveform_pad)
+  , m_long_waveform(long_wf), m_long_spectrum(long_spec), m_long_waveform_pad(long_waveform_pad)
+  , m_field_waveform(std::move(field_wf))
+{
+  if (m_compact) {
+    m_half = std::move(half);
+    return;
+  }
+  m_spectrum = expand_half(half, m_nticks);
+  m_waveform = std::move(wf);
+}
+
+void Gen::ImpactResponse::make_full() const
+{
+  if (!m_compact) {
+    return;
   }
+  std::call_once(m_full_once, [this]() {
+      m_spectrum = expand_half(m_half, m_nticks);
+      m_waveform = Waveform::idft(m_spectrum);
+    });
+}
+
+const Waveform::compseq_t& Gen::ImpactResponse::spectrum()
+{
+  make_full();
+  return m_spectrum;
+}
+
+const Waveform::compseq_t& Gen::ImpactResponse::spectrum() const
+{
+  make_full();
+  return m_spectrum;
+}
+
+const Waveform::realseq_t& Gen::ImpactResponse::waveform() const
+{
+  make_full();
+  return m_waveform;
 }
 
-const Waveform::compseq_t& Gen::ImpactResponse::long_aux_spectrum(){
-  if (m_long_spectrum.size()!=0){
-    return m_long_spectrum;
-  }else{
-    m_long_spectrum = Waveform::dft(m_long_waveform);
-    return m_long_spectrum;
+Waveform::realseq_t Gen::ImpactResponse::waveform_head(int nsamples, bool field_only) const
+{
+  // In compact mode make the waveform just for this.
+  Waveform::realseq_t temp;
+  if (m_compact && !field_only) {
+    temp = Waveform::idft(expand_half(m_half, m_nticks));
   }
+  const auto& wave = field_only ? m_field_waveform : (m_compact ? temp : m_waveform);
+  const int ncopy = std::max(0, std::min(nsamples, (int)wave.size()));
+  return Waveform::realseq_t(wave.begin(), wave.begin()+ncopy);
 }
 
 Gen::PlaneImpactResponse::PlaneImpactResponse(int plane_ident, size_t nbins, double tick)
@@ -36,6 +145,8 @@ Gen::PlaneImpactResponse::PlaneImpactResponse(int plane_ident, size_t nbins, dou
     , m_plane_ident(plane_ident)
     , m_nbins(nbins)
     , m_tick(tick)
+    , m_field_pad(0)
+    , m_compact(false)
     , l(Log::logger("geom"))
 {
 }
@@ -58,6 +169,20 @@ WireCell::Configuration Gen::PlaneImpactResponse::default_configuration() const
     cfg["nticks"] = 10000;
     // sample period of response waveforms
     cfg["tick"] = 0.5*units::us; 
+    // If not empty, a directory in which to cache built responses.
+    // A cache file is keyed by a hash of the field, short and long
+    // responses and of the parameters here so a stale one is never
+    // used.  Many jobs may share the directory.
+    cfg["cache_dir"] = m_cache_dir;
+    // The file which the field_response component reads.  If given,
+    // the cache is keyed by its name, size and modification time so
+    // that a cache hit need not load the field response.  Otherwise
+    // the field response itself is hashed.
+    cfg["field_file"] = m_field_file;
+    // If true, keep only half of each (Hermitian) response spectrum
+    // and make waveforms and full spectra only when asked for.  This
+    // roughly halves the memory of the plane's responses.
+    cfg["compact"] = m_compact;
     return cfg;
 }
 
@@ -89,8 +214,313 @@ void Gen::PlaneImpactResponse::configure(const WireCell::Configuration& cfg)
 
     m_nbins = (size_t) get(cfg, "nticks", (int)m_nbins);
     m_tick = get(cfg, "tick", m_tick);
+    m_cache_dir = get(cfg, "cache_dir", m_cache_dir);
+    m_field_file = get(cfg, "field_file", m_field_file);
+    m_compact = get(cfg, "compact", m_compact);
+
+    std::string cache_path;
+    uint64_t key = 0;
+    if (!m_cache_dir.empty()) {
+        key = cache_key();
+        char name[64];
+        snprintf(name, sizeof(name), "/pir-%016llx.bin", (unsigned long long)key);
+        cache_path = m_cache_dir + name;
+        if (load_cache(cache_path, key)) {
+            l->debug("PIR: plane {} loaded from {}", m_plane_ident, cache_path);
+            return;
+        }
+    }
 
     build_responses();
+
+    if (!cache_path.empty()) {
+        save_cache(cache_path, key);
+    }
+}
+
+
+// Cache file format, all in native byte order:
+//
+// magic, key, impact, half_extent, pitch, field_pad,
+// bywire: count then per wire count and indices,
+// short waveform, long waveform,
+// long spectrum,
+// paths: count then per path impact, number of ticks, half spectrum,
+// waveform, field waveform
+//
+// where sequences are a 64 bit count followed by the elements.  Both
+// spectra and waveforms are kept so loading needs no transforms.
+static const char pir_cache_magic[8] = {'W','C','P','I','R','C','3','\0'};
+
+namespace {
+    // 64 bit FNV-1a
+    struct Fnv1a {
+        uint64_t hash = 14695981039346656037ULL;
+        void add(const void* data, size_t size) {
+            const unsigned char* bytes = (const unsigned char*)data;
+            for (size_t ind=0; ind<size; ++ind) {
+                hash ^= bytes[ind];
+                hash *= 1099511628211ULL;
+            }
+        }
+        template<typename T>
+        void add(const T& val) { add(&val, sizeof(T)); }
+        template<typename T>
+        void add(const std::vector<T>& vec) {
+            add((uint64_t)vec.size());
+            add(vec.data(), vec.size()*sizeof(T));
+        }
+        void add(const std::string& str) {
+            add((uint64_t)str.size());
+            add(str.data(), str.size());
+        }
+    };
+
+    // Read from a mapped cache file, failing on overrun.
+    struct CacheReader {
+        const char* cur;
+        const char* end;
+        bool ok = true;
+        void read(void* dst, size_t size) {
+            if (!ok || (size_t)(end - cur) < size) {
+                ok = false;
+                return;
+            }
+            memcpy(dst, cur, size);
+            cur += size;
+        }
+        template<typename T>
+        T get() { T val{}; read(&val, sizeof(T)); return val; }
+        template<typename T>
+        std::vector<T> get_vector() {
+            const uint64_t size = get<uint64_t>();
+            if (!ok || size > (uint64_t)(end - cur)/sizeof(T)) {
+                ok = false;
+                return std::vector<T>();
+            }
+            std::vector<T> vec(size);
+            read(vec.data(), size*sizeof(T));
+            return vec;
+        }
+        template<typename T>
+        void skip_vector() {
+            const uint64_t size = get<uint64_t>();
+            if (!ok || size > (uint64_t)(end - cur)/sizeof(T)) {
+                ok = false;
+                return;
+            }
+            cur += size*sizeof(T);
+        }
+    };
+
+    template<typename T>
+    void write_value(std::ostream& out, const T& val) {
+        out.write((const char*)&val, sizeof(T));
+    }
+    template<typename T>
+    void write_vector(std::ostream& out, const std::vector<T>& vec) {
+        write_value(out, (uint64_t)vec.size());
+        out.write((const char*)vec.data(), vec.size()*sizeof(T));
+    }
+}
+
+uint64_t Gen::PlaneImpactResponse::cache_key() const
+{
+    Fnv1a h;
+    h.add(std::string(pir_cache_magic, sizeof(pir_cache_magic)));
+    h.add(m_frname);
+    h.add(m_plane_ident);
+    h.add((uint64_t)m_nbins);
+    h.add(m_tick);
+    h.add(m_overall_short_padding);
+    h.add(m_long_padding);
+
+    for (const auto* names : {&m_short, &m_long}) {
+        h.add((uint64_t)names->size());
+        for (const auto& name : *names) {
+            auto iw = Factory::find_tn<IWaveform>(name);
+            h.add(iw->waveform_period());
+            h.add(iw->waveform_samples());
+        }
+    }
+
+    if (!m_field_file.empty()) {
+        std::string path = Persist::resolve(m_field_file);
+        if (path.empty()) {
+            path = m_field_file;
+        }
+        h.add(path);
+        struct stat st;
+        if (stat(path.c_str(), &st) == 0) {
+            h.add((int64_t)st.st_size);
+            h.add((int64_t)st.st_mtime);
+        }
+        return h.hash;
+    }
+
+    // Without the file, hash the field response itself.  This loads
+    // it even on a cache hit.
+    auto ifr = Factory::find_tn<IFieldResponse>(m_frname);
+    const auto& fr = ifr->field_response();
+    h.add(fr.tstart);
+    h.add(fr.period);
+    const auto* pr = fr.plane(m_plane_ident);
+    if (pr) {
+        h.add(pr->pitch);
+        h.add((uint64_t)pr->paths.size());
+        for (const auto& path : pr->paths) {
+            h.add(path.pitchpos);
+            h.add(path.wirepos);
+            h.add(path.current);
+        }
+    }
+    return h.hash;
+}
+
+bool Gen::PlaneImpactResponse::load_cache(const std::string& path, uint64_t key)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    CacheReader in{(const char*)addr, (const char*)addr + st.st_size};
+    char magic[sizeof(pir_cache_magic)];
+    in.read(magic, sizeof(magic));
+    const uint64_t file_key = in.get<uint64_t>();
+    bool ok = in.ok && memcmp(magic, pir_cache_magic, sizeof(magic)) == 0 && file_key == key;
+
+    wire_region_indicies_t bywire;
+    std::vector<IImpactResponse::pointer> irs;
+    Waveform::realseq_t short_waveform;
+    double impact=0, half_extent=0, pitch=0;
+    int field_pad=0;
+    if (ok) {
+        impact = in.get<double>();
+        half_extent = in.get<double>();
+        pitch = in.get<double>();
+        field_pad = in.get<int>();
+        const uint64_t nwires = in.get<uint64_t>();
+        for (uint64_t iwire=0; in.ok && iwire<nwires; ++iwire) {
+            bywire.push_back(in.get_vector<int>());
+        }
+        short_waveform = in.get_vector<float>();
+        auto long_wf = std::make_shared<const Waveform::realseq_t>(in.get_vector<float>());
+        auto long_spec = std::make_shared<const Waveform::compseq_t>(in.get_vector<Waveform::complex_t>());
+        const uint64_t npaths = in.get<uint64_t>();
+        for (uint64_t ipath=0; in.ok && ipath<npaths; ++ipath) {
+            const int imp = in.get<int>();
+            const int nticks = in.get<int>();
+            auto half = in.get_vector<Waveform::complex_t>();
+            Waveform::realseq_t wf;
+            if (m_compact) {    // a compact response keeps no waveform
+                in.skip_vector<float>();
+            }
+            else {
+                wf = in.get_vector<float>();
+            }
+            auto field_wf = in.get_vector<float>();
+            if (nticks < 0 || (int)half.size() != (nticks ? nticks/2+1 : 0)
+                || (!m_compact && (int)wf.size() != nticks)) {
+                in.ok = false;
+                break;
+            }
+            irs.push_back(std::make_shared<Gen::ImpactResponse>(imp, nticks, std::move(wf), std::move(half),
+                                                                m_overall_short_padding/m_tick,
+                                                                long_wf, long_spec, m_long_padding/m_tick,
+                                                                std::move(field_wf), m_compact));
+        }
+        ok = in.ok && in.cur == in.end;
+    }
+    munmap(addr, st.st_size);
+
+    if (!ok) {
+        l->warn("PIR: ignoring bad cache file {}", path);
+        return false;
+    }
+    m_impact = impact;
+    m_half_extent = half_extent;
+    m_pitch = pitch;
+    m_field_pad = field_pad;
+    m_bywire = bywire;
+    m_short_waveform = short_waveform;
+    m_ir = irs;
+    return true;
+}
+
+void Gen::PlaneImpactResponse::save_cache(const std::string& path, uint64_t key) const
+{
+    // Write aside and rename so concurrent jobs never see a partial
+    // file.
+    const std::string tmp = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tmp, std::ios::binary);
+        if (!out) {
+            l->warn("PIR: can not write cache file {}", tmp);
+            return;
+        }
+        out.write(pir_cache_magic, sizeof(pir_cache_magic));
+        write_value(out, key);
+        write_value(out, m_impact);
+        write_value(out, m_half_extent);
+        write_value(out, m_pitch);
+        write_value(out, m_field_pad);
+        write_value(out, (uint64_t)m_bywire.size());
+        for (const auto& region : m_bywire) {
+            write_vector(out, region);
+        }
+        write_vector(out, m_short_waveform);
+        write_vector(out, m_ir.empty() ? Waveform::realseq_t() : m_ir[0]->long_aux_waveform());
+        write_vector(out, m_ir.empty() ? Waveform::compseq_t() : m_ir[0]->long_aux_spectrum());
+        write_value(out, (uint64_t)m_ir.size());
+        for (const auto& ir : m_ir) {
+            auto gir = std::dynamic_pointer_cast<Gen::ImpactResponse>(ir);
+            // Avoid keeping the full spectrum and waveform of a
+            // compact response.  The cache is shared by both modes
+            // so the waveform is always written.
+            Waveform::compseq_t half;
+            Waveform::realseq_t wf;
+            int nticks = 0;
+            if (gir && gir->compact()) {
+                half = gir->half_spectrum();
+                nticks = gir->nticks();
+                wf = gir->waveform_head(nticks);
+            }
+            else {
+                const auto& spec = ir->spectrum();
+                nticks = spec.size();
+                half.assign(spec.begin(), spec.begin() + (nticks ? nticks/2+1 : 0));
+                wf = ir->waveform();
+            }
+            write_value(out, ir->impact());
+            write_value(out, nticks);
+            write_vector(out, half);
+            write_vector(out, wf);
+            write_vector(out, gir ? gir->field_waveform() : Waveform::realseq_t());
+        }
+        if (!out) {
+            l->warn("PIR: failed writing cache file {}", tmp);
+            out.close();
+            std::remove(tmp.c_str());
+            return;
+        }
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        l->warn("PIR: can not rename cache file {}", tmp);
+        std::remove(tmp.c_str());
+        return;
+    }
+    l->debug("PIR: plane {} saved to {}", m_plane_ident, path);
 }
 
 
@@ -153,6 +583,14 @@ void Gen::PlaneImpactResponse::build_responses()
     WireCell::Waveform::realseq_t long_wf;
     if (nlong >0)
       long_wf = Waveform::idft(long_spec);
+    // One copy shared by all impact responses.
+    auto shared_long_wf = std::make_shared<const Waveform::realseq_t>(long_wf);
+    auto shared_long_spec = long_spectrum_of(long_wf);
+
+    m_short_waveform.clear();
+    if (nshort) {
+        m_short_waveform = Waveform::idft(short_spec);
+    }
    
 
     const auto& fr = ifr->field_response();
@@ -188,6 +626,7 @@ void Gen::PlaneImpactResponse::build_responses()
     const double rawresp_tick = fr.period;
     const double rawresp_max = rawresp_min + rawresp_size*rawresp_tick;
     Binning rawresp_bins(rawresp_size, rawresp_min, rawresp_max);
+    m_field_pad = std::min((int)n_short_length, (int)std::ceil(rawresp_max/m_tick));
 
     // collect paths and index by wire and impact position.
     std::map<int, region_indices_t> wire_to_ind;
@@ -232,7 +671,9 @@ void Gen::PlaneImpactResponse::build_responses()
 	Waveform::realseq_t wf = Waveform::idft(spec);
 	wf.resize(m_nbins,0);
 
-	IImpactResponse::pointer ir = std::make_shared<Gen::ImpactResponse>(ipath, wf, m_overall_short_padding/m_tick, long_wf, m_long_padding/m_tick);
+	IImpactResponse::pointer ir = std::make_shared<Gen::ImpactResponse>(ipath, wf, Waveform::compseq_t(), m_overall_short_padding/m_tick,
+									    shared_long_wf, shared_long_spec, m_long_padding/m_tick,
+									    wave, m_compact);
 	m_ir.push_back(ir);
     }
 
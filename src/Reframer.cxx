@@ -6,7 +6,8 @@
 
 #include "WireCellUtil/NamedFactory.h"
 
-#include <map>
+#include <algorithm>
+#include <functional>
 #include <unordered_set>
 
 
@@ -59,6 +60,33 @@ void Gen::Reframer::configure(const WireCell::Configuration& cfg)
     m_tbin = get(cfg, "tbin", m_tbin);
     m_fill = get(cfg, "fill", m_fill);
     m_nticks = get(cfg, "nticks", m_nticks);
+
+    // Output one trace per channel in channel order.  A
+    // Gen::AnodePlane already indexes its channels in this order.
+    m_ganode = std::dynamic_pointer_cast<const Gen::AnodePlane>(m_anode);
+    m_rows.clear();
+    if (m_ganode) {
+        m_channels = m_ganode->channel_idents();
+        return;
+    }
+    m_channels = m_anode->channels();
+    std::sort(m_channels.begin(), m_channels.end());
+    m_channels.erase(std::unique(m_channels.begin(), m_channels.end()), m_channels.end());
+    for (size_t row=0; row<m_channels.size(); ++row) {
+        m_rows[m_channels[row]] = row;
+    }
+}
+
+int Gen::Reframer::channel_row(int chid) const
+{
+    if (m_ganode) {
+        return m_ganode->channel_index(chid);
+    }
+    auto rit = m_rows.find(chid);
+    if (rit == m_rows.end()) {
+        return -1;
+    }
+    return rit->second;
 }
 
 
@@ -71,13 +99,9 @@ bool Gen::Reframer::operator()(const input_pointer& inframe, output_pointer& out
         return true;
     }
 
-    // Storage for samples indexed by channel ident.
-    std::map<int, std::vector<float> > waves;
-
-    // initialize a "rectangular" 2D array of samples
-    for (auto chid : m_anode->channels()) {
-        waves[chid].resize(m_nticks, m_fill);
-    }
+    // initialize a "rectangular" 2D array of samples, one row per
+    // channel
+    m_buffer.assign(m_channels.size()*m_nticks, m_fill);
     
     // Get traces to consider
     std::vector<ITrace::pointer> traces;
@@ -99,40 +123,40 @@ bool Gen::Reframer::operator()(const input_pointer& inframe, output_pointer& out
 
     // Lay down input traces over output waves
     for (auto trace : traces) {
-        const int chid = trace->channel();
-
-        const int tbin_in = trace->tbin();
-        auto in_it = trace->charge().begin();
-
-        auto& wave = waves[chid]; // reference
-        auto out_it = wave.begin();
+        const int row = channel_row(trace->channel());
+        if (row < 0) {
+            continue;           // not of this anode
+        }
+        const auto& charge = trace->charge();
+        float* wave = m_buffer.data() + row*m_nticks;
 
-        const int delta_tbin = m_tbin - tbin_in;
+        // Offsets into input and output.
+        int in_off = 0, out_off = 0;
+        const int delta_tbin = m_tbin - trace->tbin();
         if (delta_tbin > 0) {   // must truncate input
-            in_it += delta_tbin;
+            in_off = delta_tbin;
         }
         else {                  // must pad output
-            out_it += -delta_tbin;
+            out_off = -delta_tbin;
         }
-        
+
         // Go as far as possible but don't walk of the end of either
-        const auto in_end = trace->charge().end();
-        const auto out_end = wave.end();
-        while (in_it < in_end and out_it < out_end) {
-            *out_it += *in_it;  // accumulate
-            ++in_it;
-            ++out_it;
-        }        
+        const int nadd = std::min((int)charge.size() - in_off, m_nticks - out_off);
+        if (nadd <= 0) {
+            continue;
+        }
+        std::transform(charge.begin()+in_off, charge.begin()+in_off+nadd,
+                       wave+out_off, wave+out_off, std::plus<float>()); // accumulate
 
     }
 
     // Transfer waves into traces.
     ITrace::vector out_traces;
-    for (auto& it : waves) {
-        const int chid = it.first;
-        auto& wave = it.second;
-        auto out_trace = make_shared<SimpleTrace>(chid, 0, wave);
-        out_traces.push_back(out_trace);
+    out_traces.reserve(m_channels.size());
+    for (size_t row=0; row<m_channels.size(); ++row) {
+        auto beg = m_buffer.begin() + row*m_nticks;
+        ITrace::ChargeSequence wave(beg, beg + m_nticks);
+        out_traces.push_back(make_shared<SimpleTrace>(m_channels[row], 0, wave));
     }
 
     outframe = make_shared<SimpleFrame>(inframe->ident(),
@@ -1,6 +1,6 @@
 #include "WireCellGen/Retagger.h"
 #include "WireCellUtil/NamedFactory.h"
-#include "WireCellIface/SimpleFrame.h"
+#include "WireCellGen/FrameView.h"
 
 WIRECELL_FACTORY(Retagger, WireCell::Gen::Retagger,
                  WireCell::IFrameFilter, WireCell::IConfigurable)
@@ -37,7 +37,7 @@ bool Gen::Retagger::operator()(const input_pointer& inframe, output_pointer& out
         
 
     // Basic frame data is just shunted across.
-    auto sfout = new SimpleFrame(inframe->ident(), inframe->time(), *inframe->traces(), inframe->tick());
+    auto sfout = std::make_shared<FrameView>(inframe);
 
     //
     // frame
@@ -57,10 +57,8 @@ bool Gen::Retagger::operator()(const input_pointer& inframe, output_pointer& out
         if (touttags.empty()) {
             continue;
         }
-        const auto& traces = inframe->tagged_traces(inttag);
-        const auto& summary = inframe->trace_summary(inttag);
         for (auto otag : touttags) {
-            sfout->tag_traces(otag, traces, summary);
+            sfout->tag_traces(otag, inframe, inttag);
         }
     }
 
@@ -126,7 +124,7 @@ bool Gen::Retagger::operator()(const input_pointer& inframe, output_pointer& out
     }
 
 
-    outframe = IFrame::pointer(sfout);
+    outframe = sfout;
     return true;
 }
 
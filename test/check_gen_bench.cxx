@@ -0,0 +1,442 @@
+// Benchmark the hot paths of the gen simulation.
+//
+// Synthetic but reproducible depo workloads of several occupancies are
+// made with TrackDepos and BlipSource, drifted and then passed through
+// the various stages of the simulation.  Each stage is timed a number
+// of times and the shortest time is reported along with a throughput.
+//
+// usage: check_gen_bench [detector [nrepeat]]
+//
+// The detector is one known to anode_loader.h (default "uboone") and
+// its data files must be found via WIRECELL_PATH.  The results are
+// printed to stdout as JSON and all logging goes to stderr so the two
+// may be separated to compare results across releases.
+
+#include "anode_loader.h"
+
+#include "WireCellGen/TrackDepos.h"
+#include "WireCellGen/BlipSource.h"
+#include "WireCellGen/Drifter.h"
+#include "WireCellGen/GaussianDiffusion.h"
+#include "WireCellGen/BinnedDiffusion.h"
+#include "WireCellGen/BinnedDiffusion_transform.h"
+#include "WireCellGen/ImpactTransform.h"
+#include "WireCellGen/ImpactZipper.h"
+#include "WireCellGen/AddNoise.h"
+#include "WireCellGen/Digitizer.h"
+#include "WireCellGen/FrameUtil.h"
+#include "../src/Noise.h"
+
+#include "WireCellIface/IPlaneImpactResponse.h"
+#include "WireCellIface/IChannelSpectrum.h"
+#include "WireCellIface/IRandom.h"
+#include "WireCellIface/SimpleTrace.h"
+#include "WireCellIface/SimpleFrame.h"
+
+#include "WireCellUtil/Configuration.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const double readout = 5.0*units::ms;
+const int nticks = 10000;
+const double drift_speed = 1.6*units::mm/units::us;
+const double nsigma = 3.0;
+const std::vector<std::string> plane_names{"U","V","W"};
+
+// One synthetic workload: how many tracks and how active the blips.
+struct Workload {
+    std::string name;
+    int ntracks;
+    double activity;
+};
+
+// Time nrepeat calls of func(), each after a call to setup() which is
+// not timed, and return the shortest in seconds.
+double best_time(int nrepeat, std::function<void()> setup, std::function<void()> func)
+{
+    double best = -1;
+    for (int irep=0; irep<nrepeat; ++irep) {
+        setup();
+        auto t1 = std::chrono::steady_clock::now();
+        func();
+        auto t2 = std::chrono::steady_clock::now();
+        const double dt = std::chrono::duration<double>(t2-t1).count();
+        if (best < 0 or dt < best) {
+            best = dt;
+        }
+    }
+    return best;
+}
+
+Configuration result(std::string name, double seconds, size_t count, std::string unit)
+{
+    Configuration jres;
+    jres["name"] = name;
+    jres["seconds"] = seconds;
+    jres["count"] = (Json::UInt64)count;
+    jres["unit"] = unit;
+    jres["rate"] = seconds > 0 ? count/seconds : 0.0;
+    return jres;
+}
+
+void configure_components(const std::string& anode_tn)
+{
+    {
+        auto icfg = Factory::lookup<IConfigurable>("Random");
+        auto cfg = icfg->default_configuration();
+        icfg->configure(cfg);
+    }
+    {
+        auto icfg = Factory::lookup<IConfigurable>("ElecResponse");
+        auto cfg = icfg->default_configuration();
+        cfg["tick"] = tick;
+        icfg->configure(cfg);
+    }
+    for (int iplane=0; iplane<3; ++iplane) {
+        auto icfg = Factory::lookup<IConfigurable>("PlaneImpactResponse", plane_names[iplane]);
+        auto cfg = icfg->default_configuration();
+        cfg["plane"] = iplane;
+        cfg["tick"] = tick;
+        cfg["nticks"] = nticks;
+        cfg["short_responses"][0] = "ElecResponse";
+        icfg->configure(cfg);
+    }
+    {
+        auto icfg = Factory::lookup<IConfigurable>("EmpiricalNoiseModel");
+        auto cfg = icfg->default_configuration();
+        cfg["spectra_file"] = "microboone-noise-spectra-v2.json.bz2";
+        cfg["anode"] = anode_tn;
+        cfg["nsamples"] = nticks;
+        cfg["period"] = tick;
+        icfg->configure(cfg);
+    }
+}
+
+// Make the undrifted depos of one workload inside the face volume.
+IDepo::vector make_depos(const Workload& wl, const Ray& bounds)
+{
+    IDepo::vector depos;
+
+    std::mt19937 rng(12345);
+    auto uniform = [&](double a, double b) {
+        return std::uniform_real_distribution<double>(std::min(a,b), std::max(a,b))(rng);
+    };
+    auto point = [&]() {
+        return Point(uniform(bounds.first.x(), bounds.second.x()),
+                     uniform(bounds.first.y(), bounds.second.y()),
+                     uniform(bounds.first.z(), bounds.second.z()));
+    };
+
+    if (wl.ntracks) {
+        Gen::TrackDepos td;
+        auto cfg = td.default_configuration();
+        for (int itrack=0; itrack<wl.ntracks; ++itrack) {
+            const Point tail = point(), head = point();
+            Configuration jtrack;
+            jtrack["time"] = uniform(0, 1.0*units::ms);
+            jtrack["charge"] = -5000.0;
+            jtrack["ray"]["tail"]["x"] = tail.x();
+            jtrack["ray"]["tail"]["y"] = tail.y();
+            jtrack["ray"]["tail"]["z"] = tail.z();
+            jtrack["ray"]["head"]["x"] = head.x();
+            jtrack["ray"]["head"]["y"] = head.y();
+            jtrack["ray"]["head"]["z"] = head.z();
+            cfg["tracks"].append(jtrack);
+        }
+        td.configure(cfg);
+        IDepo::pointer depo;
+        while (td(depo) and depo) {
+            depos.push_back(depo);
+        }
+    }
+
+    if (wl.activity > 0) {
+        // The blips get their own generator, seeded afresh for each
+        // workload like the tracks above, so that the noise stages
+        // drawing from "Random" do not change the depos.
+        {
+            auto icfg = Factory::lookup<IConfigurable>("Random", "blips");
+            auto cfg = icfg->default_configuration();
+            cfg["seeds"] = Json::Value(Json::arrayValue);
+            cfg["seeds"].append(12345);
+            icfg->configure(cfg);
+        }
+        Gen::BlipSource bs;
+        auto cfg = bs.default_configuration();
+        cfg["rng"] = "Random:blips";
+        cfg["time"]["start"] = 0.0;
+        cfg["time"]["stop"] = 1.0*units::ms;
+        cfg["time"]["activity"] = wl.activity;
+        auto& ext = cfg["position"]["extent"];
+        ext["tail"]["x"] = bounds.first.x();
+        ext["tail"]["y"] = bounds.first.y();
+        ext["tail"]["z"] = bounds.first.z();
+        ext["head"]["x"] = bounds.second.x();
+        ext["head"]["y"] = bounds.second.y();
+        ext["head"]["z"] = bounds.second.z();
+        bs.configure(cfg);
+        IDepo::pointer depo;
+        while (bs(depo) and depo) {
+            depos.push_back(depo);
+        }
+    }
+
+    return depos;
+}
+
+Configuration bench_workload(const Workload& wl, IAnodeFace::pointer face,
+                             const std::string& anode_tn, int nrepeat)
+{
+    Configuration jwl;
+    jwl["name"] = wl.name;
+    Configuration& jres = jwl["results"];
+
+    const auto bounds = face->sensitive().bounds();
+    const auto depos = make_depos(wl, bounds);
+    jwl["ndepos"] = (Json::UInt64)depos.size();
+    cerr << "check_gen_bench: workload " << wl.name << " with " << depos.size() << " depos\n";
+
+    // Drifter
+    IDepo::vector drifted;
+    {
+        Gen::Drifter drifter;
+        auto cfg = drifter.default_configuration();
+        Configuration jxr;
+        jxr["anode"] = std::min(bounds.first.x(), bounds.second.x());
+        jxr["cathode"] = std::max(bounds.first.x(), bounds.second.x());
+        cfg["xregions"].append(jxr);
+        cfg["drift_speed"] = drift_speed;
+        drifter.configure(cfg);
+
+        auto secs = best_time(nrepeat, [&](){ drifted.clear(); }, [&](){
+                // As a graph node sees it, a fresh queue per call.
+                auto collect = [&](IDrifter::output_queue& outq) {
+                    for (auto& depo : outq) {
+                        if (depo) {
+                            drifted.push_back(std::move(depo));
+                        }
+                    }
+                };
+                for (auto depo : depos) {
+                    IDrifter::output_queue outq;
+                    drifter(depo, outq);
+                    collect(outq);
+                }
+                IDrifter::output_queue outq;
+                drifter(nullptr, outq);
+                collect(outq);
+            });
+        jres.append(result("Drifter", secs, depos.size(), "depos"));
+    }
+
+    const Binning tbins(nticks, 0, readout);
+    ITrace::vector traces;
+    size_t nsampled=0, nzipped=0, ntransformed=0, ncharges=0;
+    double t_sampling=0, t_charge_vec=0, t_transform=0, t_zipper=0;
+
+    int iplane = -1;
+    for (auto plane : face->planes()) {
+        ++iplane;
+        const Pimpos* pimpos = plane->pimpos();
+        const auto& wires = plane->wires();
+        auto pir = Factory::find<IPlaneImpactResponse>("PlaneImpactResponse", plane_names[iplane]);
+
+        // GaussianDiffusion::set_sampling
+        {
+            std::vector<Gen::GaussianDiffusion::pointer> gds;
+            t_sampling += best_time(nrepeat, [&](){
+                    gds.clear();
+                    for (auto depo : drifted) {
+                        Gen::GausDesc time_desc(depo->time(), depo->extent_long()/drift_speed);
+                        Gen::GausDesc pitch_desc(pimpos->distance(depo->pos()), depo->extent_tran());
+                        gds.push_back(std::make_shared<Gen::GaussianDiffusion>(depo, time_desc, pitch_desc));
+                    }
+                }, [&](){
+                    for (auto gd : gds) {
+                        gd->set_sampling(tbins, pimpos->impact_binning(), nsigma, nullptr,
+                                         Gen::BinnedDiffusion_transform::linear);
+                        gd->clear_sampling();
+                    }
+                });
+            nsampled += drifted.size();
+        }
+
+        // BinnedDiffusion_transform::get_charge_vec, using the same
+        // impact groups as does ImpactTransform.
+        {
+            Gen::BinnedDiffusion_transform bd(*pimpos, tbins, nsigma, nullptr);
+            for (auto depo : drifted) {
+                bd.add(depo, depo->extent_long()/drift_speed, depo->extent_tran());
+            }
+            const int ngroups = std::round(pir->pitch()/pir->impact())+1;
+            std::vector<int> vec_impact;
+            for (int ind=0; ind<ngroups; ++ind) {
+                const double eps = (ind == ngroups-1) ? -1e-9 : 1e-9;
+                vec_impact.push_back(std::round((-pir->pitch()/2.+pir->impact()*ind+eps)/pir->impact()));
+            }
+            std::vector<std::vector<std::tuple<int,int,double> > > vec_vec_charge;
+            t_charge_vec += best_time(nrepeat, [&](){
+                    vec_vec_charge.clear();
+                    vec_vec_charge.resize(ngroups);
+                }, [&](){
+                    bd.get_charge_vec(vec_vec_charge, vec_impact);
+                });
+            for (const auto& vc : vec_vec_charge) {
+                ncharges += vc.size();
+            }
+        }
+
+        // ImpactTransform, including the waveform extraction which
+        // DepoTransform performs.
+        {
+            Gen::BinnedDiffusion_transform bd(*pimpos, tbins, nsigma, nullptr);
+            for (auto depo : drifted) {
+                bd.add(depo, depo->extent_long()/drift_speed, depo->extent_tran());
+            }
+            ITrace::vector plane_traces;
+            t_transform += best_time(nrepeat, [&](){ plane_traces.clear(); }, [&](){
+                    Gen::ImpactTransform transform(pir, bd);
+                    const int nwires = pimpos->region_binning().nbins();
+                    for (int iwire=0; iwire<nwires; ++iwire) {
+                        auto wave = transform.waveform(iwire);
+                        auto mm = Waveform::edge(wave);
+                        if (mm.first == (int)wave.size()) {
+                            continue;
+                        }
+                        ITrace::ChargeSequence charge(wave.begin()+mm.first, wave.begin()+mm.second);
+                        plane_traces.push_back(std::make_shared<SimpleTrace>(wires[iwire]->channel(), mm.first, charge));
+                    }
+                });
+            ntransformed += wires.size();
+            traces.insert(traces.end(), plane_traces.begin(), plane_traces.end());
+        }
+
+        // ImpactZipper.  The diffusions are sampled as part of the
+        // zip so each repeat needs a fresh BinnedDiffusion.
+        {
+            std::unique_ptr<Gen::BinnedDiffusion> bd;
+            t_zipper += best_time(nrepeat, [&](){
+                    bd.reset(new Gen::BinnedDiffusion(*pimpos, tbins, nsigma, nullptr));
+                    for (auto depo : drifted) {
+                        bd->add(depo, depo->extent_long()/drift_speed, depo->extent_tran());
+                    }
+                }, [&](){
+                    Gen::zip_plane(pir, *bd, wires);
+                });
+            nzipped += wires.size();
+        }
+    }
+    jres.append(result("GaussianDiffusion::set_sampling", t_sampling, nsampled, "depos"));
+    jres.append(result("BinnedDiffusion_transform::get_charge_vec", t_charge_vec, ncharges, "charges"));
+    jres.append(result("ImpactTransform", t_transform, ntransformed, "wires"));
+    jres.append(result("ImpactZipper", t_zipper, nzipped, "wires"));
+
+    auto signal = std::make_shared<SimpleFrame>(0, 0.0, traces, tick);
+
+    // Noise::generate_waveform
+    {
+        auto model = Factory::find<IChannelSpectrum>("EmpiricalNoiseModel");
+        auto rng = Factory::find<IRandom>("Random");
+        std::vector<int> chids;
+        for (auto trace : traces) {
+            chids.push_back(trace->channel());
+        }
+        auto secs = best_time(nrepeat, [](){}, [&](){
+                for (int chid : chids) {
+                    Gen::Noise::generate_waveform((*model)(chid), rng);
+                }
+            });
+        jres.append(result("Noise::generate_waveform", secs, chids.size(), "waveforms"));
+    }
+
+    // AddNoise
+    IFrame::pointer noisy;
+    {
+        Gen::AddNoise addnoise;
+        auto cfg = addnoise.default_configuration();
+        cfg["model"] = "EmpiricalNoiseModel";
+        cfg["rng"] = "Random";
+        cfg["nsamples"] = nticks;
+        addnoise.configure(cfg);
+        auto secs = best_time(nrepeat, [](){}, [&](){ addnoise(signal, noisy); });
+        jres.append(result("AddNoise", secs, traces.size(), "traces"));
+    }
+
+    // Digitizer
+    {
+        Gen::Digitizer digitizer;
+        auto cfg = digitizer.default_configuration();
+        cfg["anode"] = anode_tn;
+        digitizer.configure(cfg);
+        IFrame::pointer adc;
+        auto secs = best_time(nrepeat, [](){}, [&](){ digitizer(noisy, adc); });
+        jres.append(result("Digitizer", secs, noisy->traces()->size(), "traces"));
+    }
+
+    // Gen::sum
+    {
+        auto secs = best_time(nrepeat, [](){}, [&](){ Gen::sum({signal, noisy}, 0); });
+        jres.append(result("Gen::sum", secs, traces.size() + noisy->traces()->size(), "traces"));
+    }
+
+    return jwl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    int nrepeat = 3;
+    if (argc > 2) {
+        nrepeat = atoi(argv[2]);
+    }
+
+    auto anode_tns = anode_loader(detector);
+    const std::string anode_tn = anode_tns.front();
+    configure_components(anode_tn);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tn);
+    IAnodeFace::pointer face = nullptr;
+    for (auto one : anode->faces()) {
+        if (one and not one->sensitive().empty()) {
+            face = one;
+            break;
+        }
+    }
+    if (!face) {
+        cerr << "check_gen_bench: no sensitive face in " << anode_tn << endl;
+        return 1;
+    }
+
+    const std::vector<Workload> workloads{
+        {"tracks-1", 1, 0.0},
+        {"tracks-10", 10, 0.0},
+        {"tracks-100", 100, 0.0},
+        {"blips-1k", 0, 1e6*units::Bq},
+        {"blips-10k", 0, 1e7*units::Bq},
+        {"mixed", 10, 1e6*units::Bq},
+    };
+
+    Configuration jtop;
+    jtop["detector"] = detector;
+    jtop["anode"] = anode_tn;
+    jtop["nrepeat"] = nrepeat;
+    jtop["nticks"] = nticks;
+    jtop["tick"] = tick;
+    for (const auto& wl : workloads) {
+        jtop["workloads"].append(bench_workload(wl, face, anode_tn, nrepeat));
+    }
+
+    cout << jtop << endl;
+    return 0;
+}
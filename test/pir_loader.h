@@ -0,0 +1,50 @@
+// DO NO USE
+//
+// Like anode_loader.h, this reproduces some internal configuration
+// so that unit tests need not specify a configuration file.  It
+// configures one PlaneImpactResponse per plane, named with the given
+// prefix, with the electronics response as the short response.  Any
+// extra parameters are applied to each.  The field response must
+// already be configured, eg by anode_loader().
+
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/String.h"
+#include "WireCellUtil/Units.h"
+#include "WireCellUtil/Configuration.h"
+
+#include "WireCellIface/IConfigurable.h"
+
+#include <vector>
+#include <string>
+
+std::vector<std::string> pir_loader(const std::string& prefix, double tick, int nticks,
+                                    WireCell::Configuration extra = WireCell::Configuration())
+{
+    using namespace WireCell;
+
+    {
+        auto icfg = Factory::lookup<IConfigurable>("ElecResponse");
+        auto cfg = icfg->default_configuration();
+        cfg["tick"] = tick;
+        icfg->configure(cfg);
+    }
+
+    std::vector<std::string> ret;
+    for (int iplane=0; iplane<3; ++iplane) {
+        const std::string name = String::format("%s%d", prefix, iplane);
+        auto icfg = Factory::lookup<IConfigurable>("PlaneImpactResponse", name);
+        auto cfg = icfg->default_configuration();
+        cfg["plane"] = iplane;
+        cfg["tick"] = tick;
+        cfg["nticks"] = nticks;
+        cfg["short_responses"][0] = "ElecResponse";
+        if (extra.isObject()) {
+            for (auto key : extra.getMemberNames()) {
+                cfg[key] = extra[key];
+            }
+        }
+        icfg->configure(cfg);
+        ret.push_back("PlaneImpactResponse:" + name);
+    }
+    return ret;
+}
@@ -4,6 +4,11 @@
 #include "WireCellUtil/Units.h"
 #include "WireCellUtil/NamedFactory.h"
 #include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Point.h"
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 
 #include "anode_loader.h"
@@ -24,6 +29,39 @@ int main(int argc, char* argv[])
         auto chans = iap->channels();
         cerr << "Anode " << anode_tn << " with " << chans.size() << " channels:\n";
 
+        // Build the dense channel index expectations from the wires
+        // themselves rather than from the lookups that use it.
+        auto gap = std::dynamic_pointer_cast<Gen::AnodePlane>(iap);
+        Assert(gap);
+        Assert(gap->nchannels() == chans.size());
+        std::vector<double> lengths(gap->nchannels(), 0.0);
+        std::vector<size_t> nwires(gap->nchannels(), 0);
+        for (auto face : iap->faces()) {
+            for (auto plane : face->planes()) {
+                for (auto wire : plane->wires()) {
+                    const int ind = gap->channel_index(wire->channel());
+                    Assert(ind >= 0 && ind < (int)gap->nchannels());
+                    Assert(gap->channel_idents()[ind] == wire->channel());
+                    Assert(gap->channel_wpids()[ind] == wire->planeid().ident());
+                    Assert(gap->channel_planes()[ind] == wire->planeid().index());
+                    const auto& cwires = gap->channel_wires(ind);
+                    Assert(std::find(cwires.begin(), cwires.end(), wire) != cwires.end());
+                    lengths[ind] += ray_length(wire->ray());
+                    ++nwires[ind];
+                }
+            }
+        }
+        for (size_t ind=0; ind<gap->nchannels(); ++ind) {
+            Assert(nwires[ind] > 0);
+            Assert(gap->channel_wires(ind).size() == nwires[ind]);
+            Assert(std::abs(gap->channel_wire_lengths()[ind] - lengths[ind]) < 1e-6*lengths[ind]);
+            Assert(gap->channel_at(ind)->ident() == gap->channel_idents()[ind]);
+            if (ind > 0) {
+                Assert(gap->channel_idents()[ind-1] < gap->channel_idents()[ind]);
+            }
+        }
+        Assert(gap->channel_index(chans.back()+1) == -1);
+
         for (auto face : iap->faces()) {
             cerr << "face: " << face->ident() << "\n";
             std::vector<float> originx;
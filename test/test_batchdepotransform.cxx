@@ -0,0 +1,144 @@
+// Check that BatchDepoTransform gives each event of a batch the same
+// frame as DepoTransform gives it alone.  The depos sit at the edges
+// of the planes with a wide transverse extent so their charge would
+// diffuse into the gaps between the stacked events.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellGen/BatchDepoTransform.h"
+
+#include "WireCellIface/IDepoFramer.h"
+#include "WireCellIface/SimpleDepo.h"
+#include "WireCellIface/SimpleDepoSet.h"
+
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 2000;
+const double readout = nticks*tick;
+
+typedef std::map<int, std::vector<float> > channel_waves_t;
+
+Configuration common_config(Configuration cfg, const std::string& anode_tn,
+                            const std::vector<std::string>& pir_tns)
+{
+    cfg["anode"] = anode_tn;
+    cfg["tick"] = tick;
+    cfg["start_time"] = 0.0;
+    cfg["readout_time"] = readout;
+    cfg["roi_tiling"] = true;
+    for (const auto& tn : pir_tns) {
+        cfg["pirs"].append(tn);
+    }
+    return cfg;
+}
+
+channel_waves_t frame_waves(IFrame::pointer frame)
+{
+    Assert(frame);
+    channel_waves_t waves;
+    for (auto trace : *frame->traces()) {
+        auto& wave = waves[trace->channel()];
+        wave.resize(nticks, 0.0);
+        const auto& charge = trace->charge();
+        for (size_t ind=0; ind<charge.size(); ++ind) {
+            wave.at(trace->tbin() + ind) += charge[ind];
+        }
+    }
+    return waves;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto pir_tns = pir_loader("batch", tick, nticks);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tns[0]);
+    const auto bounds = anode->faces()[0]->sensitive().bounds();
+    const Point lo = bounds.first, hi = bounds.second;
+    const Point center = (lo + hi)*0.5;
+    const double inset = 1.0*units::mm;
+
+    // Each event has depos at a different pair of corners, which
+    // are the ends of every plane, and one in the middle.
+    const int nevents = 3;
+    std::vector<IDepoSet::pointer> sets;
+    for (int iev=0; iev<nevents; ++iev) {
+        const double y1 = (iev%2) ? hi.y()-inset : lo.y()+inset;
+        const double z1 = (iev/2) ? hi.z()-inset : lo.z()+inset;
+        const double y2 = lo.y() + hi.y() - y1, z2 = lo.z() + hi.z() - z1;
+        IDepo::vector depos;
+        int count = 0;
+        for (const Point& pos : {Point(center.x(), y1, z1), Point(center.x(), y2, z2),
+                    Point(center.x(), center.y(), center.z() + iev*units::cm)}) {
+            const double time = 0.2*readout + (count++)*0.2*readout + iev*10*tick;
+            depos.push_back(make_shared<SimpleDepo>(time, pos, -5000.0*(iev+1), nullptr,
+                                                    1.0*units::mm, 5.0*units::mm));
+        }
+        sets.push_back(make_shared<SimpleDepoSet>(iev, depos));
+    }
+
+    Gen::BatchDepoTransform batch;
+    {
+        auto cfg = common_config(batch.default_configuration(), anode_tns[0], pir_tns);
+        cfg["batch_size"] = nevents;
+        batch.configure(cfg);
+    }
+    Gen::BatchDepoTransform::output_queue batched;
+    for (auto set : sets) {
+        batch(set, batched);
+    }
+    batch(nullptr, batched);
+    Assert(batched.size() == (size_t)nevents + 1);
+    Assert(batched.back() == nullptr);
+
+    auto icfg = Factory::lookup<IConfigurable>("DepoTransform", "single");
+    icfg->configure(common_config(icfg->default_configuration(), anode_tns[0], pir_tns));
+    auto single = Factory::find<IDepoFramer>("DepoTransform", "single");
+
+    for (int iev=0; iev<nevents; ++iev) {
+        IFrame::pointer frame;
+        (*single)(sets[iev], frame);
+        auto expected = frame_waves(frame);
+        auto got = frame_waves(batched[iev]);
+
+        float peak = 0, maxdiff = 0;
+        for (const auto& it : expected) {
+            for (float val : it.second) {
+                peak = std::max(peak, std::abs(val));
+            }
+        }
+        // Channels in either frame, so a leak onto a channel the
+        // event alone does not touch is caught.
+        channel_waves_t all = expected;
+        for (const auto& it : got) {
+            all[it.first].resize(nticks, 0.0);
+        }
+        for (const auto& it : all) {
+            const auto eit = expected.find(it.first);
+            const auto git = got.find(it.first);
+            for (int itick=0; itick<nticks; ++itick) {
+                const float want = eit == expected.end() ? 0.0 : eit->second[itick];
+                const float have = git == got.end() ? 0.0 : git->second[itick];
+                maxdiff = std::max(maxdiff, std::abs(want - have));
+            }
+        }
+        cerr << "event " << iev << ": " << expected.size() << " vs " << got.size()
+             << " channels, peak " << peak << ", max difference " << maxdiff << endl;
+        Assert(peak > 0);
+        Assert(maxdiff < 1e-3*peak);
+    }
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include "WireCellGen/DepoPlaneX.h"
 #include "WireCellIface/SimpleDepo.h"
+#include "WireCellUtil/Testing.h"
 
 #include <iostream>
 
@@ -34,6 +35,10 @@ void test_depoplanex()
 	std::cerr << " <--- ";
 	std::cerr << "x=" << depo->prior()->pos().x()/units::cm << "cm, t=" << depo->prior()->time()/tunit << "us\n";
     }
+    for (size_t ind=1; ind<removed.size(); ++ind) {
+        Assert(removed[ind-1]->time() <= removed[ind]->time());
+    }
+    Assert(removed.size() + dpx.frozen_queue().size() == times.size()*xes.size());
     std::cerr << "Frozen " << dpx.frozen_queue().size() << std::endl;
     for (auto depo : dpx.frozen_queue()) {
 	std::cerr << "\tx=" << depo->pos().x()/units::cm << "cm, t=" << depo->time()/tunit << "us";
@@ -0,0 +1,121 @@
+// Check that DepoTransform in streaming mode carries the response
+// which crosses a readout boundary into the next readout.  Two
+// streamed readouts must give the same waveforms as one readout
+// twice as long.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellIface/IDepoFramer.h"
+#include "WireCellIface/SimpleDepo.h"
+#include "WireCellIface/SimpleDepoSet.h"
+
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 2000;        // per streamed readout
+const double readout = nticks*tick;
+
+typedef std::map<int, std::vector<float> > channel_waves_t;
+
+IDepoFramer::pointer make_transform(const std::string& name, const std::string& anode_tn,
+                                    const std::vector<std::string>& pir_tns,
+                                    double readout_time, bool streaming)
+{
+    auto icfg = Factory::lookup<IConfigurable>("DepoTransform", name);
+    auto cfg = icfg->default_configuration();
+    cfg["anode"] = anode_tn;
+    cfg["tick"] = tick;
+    cfg["start_time"] = 0.0;
+    cfg["readout_time"] = readout_time;
+    cfg["streaming"] = streaming;
+    cfg["channel_basis"] = true;
+    for (const auto& tn : pir_tns) {
+        cfg["pirs"].append(tn);
+    }
+    icfg->configure(cfg);
+    return Factory::find<IDepoFramer>("DepoTransform", name);
+}
+
+// Add the frame's traces, placed at the given tick, to the waves.
+void add_frame(IFrame::pointer frame, int offset, channel_waves_t& waves)
+{
+    Assert(frame);
+    for (auto trace : *frame->traces()) {
+        auto& wave = waves[trace->channel()];
+        wave.resize(2*nticks, 0.0);
+        const auto& charge = trace->charge();
+        for (size_t ind=0; ind<charge.size(); ++ind) {
+            const int itick = offset + trace->tbin() + ind;
+            if (itick < 2*nticks) {
+                wave[itick] += charge[ind];
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto pir_tns = pir_loader("stream", tick, 10000);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tns[0]);
+    const auto bounds = anode->faces()[0]->sensitive().bounds();
+    const Point center = (bounds.first + bounds.second)*0.5;
+
+    // Depos near the end of the first readout so their response
+    // crosses into the second, and one well inside it.
+    IDepo::vector depos;
+    int count = 0;
+    for (double time : {0.5*readout, readout - 20*units::us, readout - 5*units::us}) {
+        const Point pos = center + Vector(0, 0, (count++)*3*units::cm);
+        depos.push_back(make_shared<SimpleDepo>(time, pos, -5000.0, nullptr,
+                                                1.0*units::mm, 1.0*units::mm));
+    }
+
+    auto streamer = make_transform("stream", anode_tns[0], pir_tns, readout, true);
+    auto oneshot = make_transform("oneshot", anode_tns[0], pir_tns, 2*readout, false);
+
+    channel_waves_t streamed, expected;
+    IFrame::pointer frame;
+    (*streamer)(make_shared<SimpleDepoSet>(0, depos), frame);
+    add_frame(frame, 0, streamed);
+    (*streamer)(make_shared<SimpleDepoSet>(1, IDepo::vector()), frame);
+    Assert(frame->traces()->size() > 0); // the carried tails
+    add_frame(frame, nticks, streamed);
+    (*oneshot)(make_shared<SimpleDepoSet>(0, depos), frame);
+    add_frame(frame, 0, expected);
+
+    Assert(streamed.size() == expected.size());
+    float peak = 0, maxdiff = 0;
+    double qstreamed = 0, qexpected = 0;
+    for (const auto& it : expected) {
+        auto sit = streamed.find(it.first);
+        Assert(sit != streamed.end());
+        for (int itick=0; itick<2*nticks; ++itick) {
+            const float want = it.second[itick];
+            const float got = sit->second[itick];
+            peak = std::max(peak, std::abs(want));
+            maxdiff = std::max(maxdiff, std::abs(want - got));
+            qexpected += want;
+            qstreamed += got;
+        }
+    }
+    cerr << "peak " << peak << ", max difference " << maxdiff
+         << ", total charge " << qexpected << " vs " << qstreamed << endl;
+    Assert(peak > 0);
+    Assert(maxdiff < 1e-3*peak);
+    Assert(std::abs(qexpected - qstreamed) <= 1e-3*std::abs(qexpected) + 1e-3*peak);
+    return 0;
+}
@@ -46,6 +46,22 @@ int main()
     Assert(f3->tick() == tick);
     auto traces = f3->traces();
     Assert(traces->size() == 4);
+    {
+        // Signal starts 1ms, or 2000 ticks, after the noise.
+        const int tbinoff = round((signal_start_time-noise_start_time)/tick);
+        int last_ch = -1;
+        for (auto trace : *traces) {
+            Assert(trace->channel() > last_ch);
+            last_ch = trace->channel();
+            Assert(trace->tbin() == 0);
+        }
+        const auto& ch1 = traces->at(1)->charge();
+        Assert((int)ch1.size() == nsamples);
+        Assert(ch1[tbinoff+10+3] == 3.0f-0.5f);
+        Assert(ch1[tbinoff+20+9] == 9.0f-0.5f);
+        const auto& ch2 = traces->at(2)->charge();
+        Assert(ch2[tbinoff+33+1] == signal[4]+signal[1]-0.5f);
+    }
     cerr << "Frame #"<<f3->ident()<<" time=" << f3->time()/units::ms << "ms\n";
     for (auto trace : *traces) {
         const auto& charge = trace->charge();
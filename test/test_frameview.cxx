@@ -0,0 +1,100 @@
+#include "WireCellGen/FrameView.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Exceptions.h"
+#include "WireCellUtil/Units.h"
+#include "WireCellIface/SimpleFrame.h"
+#include "WireCellIface/SimpleTrace.h"
+
+#include <algorithm>
+#include <iostream>
+
+using namespace std;
+using namespace WireCell;
+
+int main()
+{
+    const double tick = 0.5*units::us;
+    vector<float> charge{0.0,1.0,2.0,1.0,0.0};
+    ITrace::vector traces{
+        make_shared<SimpleTrace>(1, 10, charge),
+            make_shared<SimpleTrace>(2, 20, charge),
+            make_shared<SimpleTrace>(3, 30, charge),
+            make_shared<SimpleTrace>(4, 40, charge)};
+
+    Waveform::ChannelMaskMap cmm;
+    cmm["bad"][2].push_back(Waveform::BinRange(0, 10));
+    auto parent = make_shared<SimpleFrame>(7, 1*units::ms, traces, tick, cmm);
+    parent->tag_traces("even", IFrame::trace_list_t{1, 3}, IFrame::trace_summary_t{0.5, 1.5});
+
+    // A view shares the traces but, like a SimpleFrame remade from
+    // them, has no tags and no masks.
+    auto view = make_shared<Gen::FrameView>(parent);
+    Assert(view->ident() == 7);
+    Assert(view->time() == parent->time());
+    Assert(view->tick() == tick);
+    Assert(view->traces() == parent->traces());
+    Assert(view->masks().empty());
+    Assert(view->trace_tags().empty());
+    Assert(view->tagged_traces("even").empty());
+
+    // A copied tag.
+    view->tag_traces("odd", IFrame::trace_list_t{0, 2});
+    Assert(view->tagged_traces("odd") == IFrame::trace_list_t({0, 2}));
+    Assert(view->trace_summary("odd").empty());
+
+    // A tag referenced from a frame sharing the traces, which the
+    // view keeps alive.
+    {
+        auto other_view = make_shared<Gen::FrameView>(parent);
+        other_view->tag_traces("low", IFrame::trace_list_t{0, 1}, IFrame::trace_summary_t{2.0, 3.0});
+        view->tag_traces("evens", parent, "even");
+        view->tag_traces("lows", other_view, "low");
+        Assert(&view->tagged_traces("evens") == &parent->tagged_traces("even"));
+        Assert(&view->trace_summary("evens") == &parent->trace_summary("even"));
+    }
+    Assert(view->tagged_traces("evens") == IFrame::trace_list_t({1, 3}));
+    Assert(view->trace_summary("evens") == IFrame::trace_summary_t({0.5, 1.5}));
+    Assert(view->tagged_traces("lows") == IFrame::trace_list_t({0, 1}));
+    Assert(view->trace_summary("lows") == IFrame::trace_summary_t({2.0, 3.0}));
+
+    // Tagging again with the same tag replaces the list, whether
+    // copied or referenced, and lists the tag once.
+    view->tag_traces("odd", IFrame::trace_list_t{2});
+    Assert(view->tagged_traces("odd") == IFrame::trace_list_t({2}));
+    view->tag_traces("odd", parent, "even");
+    Assert(view->tagged_traces("odd") == IFrame::trace_list_t({1, 3}));
+    Assert(view->trace_summary("odd") == IFrame::trace_summary_t({0.5, 1.5}));
+    view->tag_traces("evens", IFrame::trace_list_t{0});
+    Assert(view->tagged_traces("evens") == IFrame::trace_list_t({0}));
+    Assert(view->trace_summary("evens").empty());
+    Assert(parent->tagged_traces("even") == IFrame::trace_list_t({1, 3}));
+
+    const auto& tags = view->trace_tags();
+    Assert(tags.size() == 3);
+    for (const auto& tag : {"odd", "evens", "lows"}) {
+        Assert(std::count(tags.begin(), tags.end(), tag) == 1);
+    }
+
+    // Indices only make sense against the same trace vector.
+    {
+        auto stranger = make_shared<SimpleFrame>(8, 1*units::ms, traces, tick);
+        stranger->tag_traces("even", IFrame::trace_list_t{1, 3});
+        bool threw = false;
+        try {
+            view->tag_traces("stranger", stranger, "even");
+        }
+        catch (ValueError& err) {
+            threw = true;
+        }
+        Assert(threw);
+        Assert(view->tagged_traces("stranger").empty());
+    }
+
+    // Frame tags are held by the view alone.
+    view->tag_frame("viewed");
+    Assert(view->frame_tags().size() == 1);
+    Assert(parent->frame_tags().empty());
+
+    cerr << "FrameView ok\n";
+    return 0;
+}
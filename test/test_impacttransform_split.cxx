@@ -0,0 +1,92 @@
+// Check that ImpactTransform gives the same waveforms whether it
+// convolves with the combined response or with the field response
+// followed by the short responses.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellGen/BinnedDiffusion_transform.h"
+#include "WireCellGen/ImpactTransform.h"
+
+#include "WireCellIface/IPlaneImpactResponse.h"
+#include "WireCellIface/SimpleDepo.h"
+
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <cmath>
+#include <iostream>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 4000;
+
+std::vector<Waveform::realseq_t> plane_waves(IPlaneImpactResponse::pointer pir, const Pimpos& pimpos,
+                                             const Binning& tbins, const IDepo::vector& depos, bool split)
+{
+    Gen::BinnedDiffusion_transform bd(pimpos, tbins, 3.0, nullptr);
+    for (auto depo : depos) {
+        bd.add(depo, 1.0*units::us, 1.0*units::mm);
+    }
+    Gen::ImpactTransform transform(pir, bd, 0, false, split);
+    std::vector<Waveform::realseq_t> waves;
+    const int nwires = pimpos.region_binning().nbins();
+    for (int iwire=0; iwire<nwires; ++iwire) {
+        waves.push_back(transform.waveform(iwire));
+    }
+    return waves;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto pir_tns = pir_loader("split", tick, nticks);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tns[0]);
+    auto face = anode->faces()[0];
+    Binning tbins(nticks, 0, nticks*tick);
+
+    int iplane = -1;
+    for (auto plane : face->planes()) {
+        ++iplane;
+        auto pir = Factory::find_tn<IPlaneImpactResponse>(pir_tns[iplane]);
+        const Pimpos* pimpos = plane->pimpos();
+        const auto rb = pimpos->region_binning();
+
+        IDepo::vector depos;
+        for (int iwire : {rb.nbins()/4, rb.nbins()/2, rb.nbins()/2 + 3}) {
+            const double pitch = rb.center(iwire) + 0.1*rb.binsize();
+            const Point pos = pimpos->origin() + pimpos->axis(2)*pitch;
+            depos.push_back(make_shared<SimpleDepo>(0.5*units::ms + iwire*tick, pos, -5000.0));
+        }
+
+        auto combined = plane_waves(pir, *pimpos, tbins, depos, false);
+        auto split = plane_waves(pir, *pimpos, tbins, depos, true);
+        Assert(combined.size() == split.size());
+
+        float peak = 0;
+        for (const auto& wave : combined) {
+            for (float val : wave) {
+                peak = std::max(peak, std::abs(val));
+            }
+        }
+        Assert(peak > 0);
+
+        float maxdiff = 0;
+        for (size_t iwire=0; iwire<combined.size(); ++iwire) {
+            Assert(combined[iwire].size() == split[iwire].size());
+            for (size_t itick=0; itick<combined[iwire].size(); ++itick) {
+                maxdiff = std::max(maxdiff, std::abs(combined[iwire][itick] - split[iwire][itick]));
+            }
+        }
+        cerr << "plane " << iplane << ": peak " << peak << ", max difference " << maxdiff << endl;
+        Assert(maxdiff < 1e-3*peak);
+    }
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "WireCellGen/MultiDepoMerger.h"
+#include "WireCellGen/DepoSetFanin.h"
+#include "WireCellIface/SimpleDepo.h"
+#include "WireCellIface/SimpleDepoSet.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Units.h"
+
+#include <iostream>
+
+using namespace WireCell;
+
+static
+IDepo::pointer make_depo(double t)
+{
+    return std::make_shared<SimpleDepo>(t*units::us, Point(0,0,0));
+}
+
+static
+std::vector<IDepo::pointer> drain(IHydraNodeBase::any_queue_type& q)
+{
+    std::vector<IDepo::pointer> ret;
+    for (auto a : q) {
+        ret.push_back(boost::any_cast<IDepo::pointer>(a));
+    }
+    q.clear();
+    return ret;
+}
+
+void test_stream()
+{
+    const size_t nports = 3;
+    Gen::MultiDepoMerger mdm(nports);
+    auto cfg = mdm.default_configuration();
+    cfg["multiplicity"] = (int)nports;
+    mdm.configure(cfg);
+    Assert(mdm.input_types().size() == nports);
+
+    std::vector< std::vector<double> > times = {
+        {1, 4, 7, 10},
+        {2, 5},
+        {3, 6, 8, 9, 11},
+    };
+
+    IHydraNodeBase::any_queue_vector inqs(nports), outqs(1);
+    std::vector<IDepo::pointer> got;
+
+    // Feed one depo at a time, round robin, then EOS on each port.
+    size_t nleft = 0;
+    for (const auto& ts : times) { nleft += ts.size(); }
+    std::vector<size_t> next(nports, 0);
+    std::vector<bool> sent_eos(nports, false);
+    while (true) {
+        bool any = false;
+        for (size_t port=0; port<nports; ++port) {
+            if (next[port] < times[port].size()) {
+                inqs[port].push_back(make_depo(times[port][next[port]++]));
+                any = true;
+            }
+            else if (!sent_eos[port]) {
+                inqs[port].push_back(IDepo::pointer(nullptr));
+                sent_eos[port] = true;
+                any = true;
+            }
+            mdm(inqs, outqs);
+            auto more = drain(outqs[0]);
+            got.insert(got.end(), more.begin(), more.end());
+        }
+        if (!any) { break; }
+    }
+
+    Assert(!got.empty());
+    Assert(got.back() == nullptr);
+    got.pop_back();
+    Assert(got.size() == nleft);
+    for (size_t ind=1; ind<got.size(); ++ind) {
+        Assert(got[ind-1]->time() <= got[ind]->time());
+    }
+    for (auto q : inqs) {
+        Assert(q.empty());
+    }
+}
+
+void test_sets()
+{
+    const size_t nports = 3;
+    Gen::DepoSetFanin dsf(nports);
+    auto cfg = dsf.default_configuration();
+    cfg["multiplicity"] = (int)nports;
+    dsf.configure(cfg);
+    Assert(dsf.input_types().size() == nports);
+
+    std::vector< std::vector<double> > times = {
+        {1, 4, 7, 10},
+        {5, 2},                 // not sorted
+        {3, 6, 8, 9, 11},
+    };
+    IDepoSet::vector sets;
+    for (size_t port=0; port<nports; ++port) {
+        IDepo::vector depos;
+        for (auto t : times[port]) {
+            depos.push_back(make_depo(t));
+        }
+        sets.push_back(std::make_shared<SimpleDepoSet>(42+port, depos));
+    }
+
+    IDepoSet::pointer out;
+    bool ok = dsf(sets, out);
+    Assert(ok);
+    Assert(out);
+    Assert(out->ident() == 42);
+    auto depos = out->depos();
+    Assert(depos->size() == 11);
+    for (size_t ind=1; ind<depos->size(); ++ind) {
+        Assert(depos->at(ind-1)->time() <= depos->at(ind)->time());
+    }
+
+    IDepoSet::vector eos(nports, nullptr);
+    ok = dsf(eos, out);
+    Assert(ok);
+    Assert(!out);
+}
+
+int main()
+{
+    test_stream();
+    test_sets();
+    std::cerr << "done\n";
+    return 0;
+}
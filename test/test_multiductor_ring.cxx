@@ -0,0 +1,200 @@
+// Check that MultiDuctor sums sub ductor frames which do not line up
+// with its own readouts.  One sub ductor has longer readouts than
+// the MultiDuctor and one has readouts offset from it, so their
+// frames cross the readout ends and run past the short ring tail.
+// Samples are then spilled and the ring head wraps.  The output is
+// compared to a dense sum of the frames which twin sub ductors make
+// when given the same depos and flushes.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellIface/IDuctor.h"
+#include "WireCellIface/SimpleDepo.h"
+
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 1000;        // per MultiDuctor readout
+const double readout = nticks*tick;
+
+typedef std::map<int, std::vector<float> > channel_waves_t;
+
+IDuctor::pointer make_ductor(const std::string& name, const std::string& anode_tn,
+                             const std::vector<std::string>& pir_tns,
+                             double start_time, double readout_time)
+{
+    auto icfg = Factory::lookup<IConfigurable>("Ductor", name);
+    auto cfg = icfg->default_configuration();
+    cfg["anode"] = anode_tn;
+    cfg["tick"] = tick;
+    cfg["start_time"] = start_time;
+    cfg["readout_time"] = readout_time;
+    cfg["continuous"] = true;
+    cfg["fluctuate"] = false;
+    cfg["pirs"] = Json::arrayValue;
+    for (const auto& tn : pir_tns) {
+        cfg["pirs"].append(tn);
+    }
+    icfg->configure(cfg);
+    return Factory::find<IDuctor>("Ductor", name);
+}
+
+// Add the frames' samples before the given tick, by absolute tick.
+void add_frames(const IDuctor::output_queue& frames, int end, channel_waves_t& waves)
+{
+    for (auto frame : frames) {
+        if (!frame) {
+            continue;
+        }
+        const int offset = std::round(frame->time()/tick);
+        for (auto trace : *frame->traces()) {
+            auto& wave = waves[trace->channel()];
+            wave.resize(end, 0.0);
+            const auto& charge = trace->charge();
+            for (size_t ind=0; ind<charge.size(); ++ind) {
+                const int itick = offset + trace->tbin() + ind;
+                Assert(itick >= 0);
+                if (itick < end) {
+                    wave[itick] += charge[ind];
+                }
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    const auto& anode_tn = anode_tns[0];
+
+    // Ductor wants responses as long as its readout.
+    auto long_tns = pir_loader("ringlong", tick, 3*nticks/2);
+    auto offset_tns = pir_loader("ringoffset", tick, nticks);
+    const double offset_start = 0.4*readout;
+    make_ductor("ringlong", anode_tn, long_tns, 0.0, 1.5*readout);
+    make_ductor("ringoffset", anode_tn, offset_tns, offset_start, readout);
+    auto ref_long = make_ductor("reflong", anode_tn, long_tns, 0.0, 1.5*readout);
+    auto ref_offset = make_ductor("refoffset", anode_tn, offset_tns, offset_start, readout);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tn);
+    auto face = anode->faces()[0];
+    const int nwires = face->planes()[2]->wires().size();
+    const auto bounds = face->sensitive().bounds();
+    const Point lo = bounds.first, hi = bounds.second;
+
+    IDuctor::pointer multi;
+    {
+        auto icfg = Factory::lookup<IConfigurable>("MultiDuctor", "ring");
+        auto cfg = icfg->default_configuration();
+        cfg["anode"] = anode_tn;
+        cfg["tick"] = tick;
+        cfg["start_time"] = 0.0;
+        cfg["readout_time"] = readout;
+        cfg["continuous"] = true;
+        // A tail shorter than the frames forces spills, and a ring
+        // which is not a multiple of the readout makes the head wrap.
+        cfg["tail_time"] = 100*tick;
+
+        // Depos over the first half of the collection wires go to
+        // the long ductor, the rest to the offset one.
+        Configuration jrange;
+        jrange["plane"] = 2;
+        jrange["min"] = 0;
+        jrange["max"] = nwires/2;
+        Configuration first, second;
+        first["ductor"] = "Ductor:ringlong";
+        first["rule"] = "wirebounds";
+        first["args"][0][0] = jrange;
+        second["ductor"] = "Ductor:ringoffset";
+        second["rule"] = "bool";
+        second["args"] = true;
+        cfg["chains"][0][0] = first;
+        cfg["chains"][0][1] = second;
+        icfg->configure(cfg);
+        multi = Factory::find<IDuctor>("MultiDuctor", "ring");
+    }
+
+    // Depos over several readouts, alternating between well inside
+    // each half of the collection plane.
+    IDepo::vector depos;
+    const int ndepos = 60;
+    for (int ind=0; ind<ndepos; ++ind) {
+        const bool first_half = ind%2 == 0;
+        const double frac = (first_half ? 0.05 : 0.55) + 0.4*((ind*7)%10)/10.0;
+        const Point pos(0.5*(lo.x()+hi.x()), 0.5*(lo.y()+hi.y()), lo.z() + frac*(hi.z()-lo.z()));
+        const double time = 0.1*readout + ind*0.09*readout;
+        depos.push_back(make_shared<SimpleDepo>(time, pos, -5000.0, nullptr,
+                                                1.0*units::mm, 1.0*units::mm));
+    }
+
+    // Give the twins the same depos and the same flushes which
+    // MultiDuctor gives its sub ductors: one at the end of each of
+    // its readouts and one at EOS.
+    IDuctor::output_queue outframes, refframes;
+    double start = 0.0;
+    for (int ind=0; ind<ndepos; ++ind) {
+        auto depo = depos[ind];
+        (*multi)(depo, outframes);
+        auto ref = ind%2 == 0 ? ref_long : ref_offset;
+        (*ref)(depo, refframes);
+        if (depo->time() > start + readout) {
+            (*ref_long)(nullptr, refframes);
+            (*ref_offset)(nullptr, refframes);
+            start += readout;
+        }
+    }
+    (*multi)(nullptr, outframes);
+    (*ref_long)(nullptr, refframes);
+    (*ref_offset)(nullptr, refframes);
+
+    Assert(outframes.back() == nullptr);
+    const int nout = outframes.size() - 1;
+    Assert(nout >= 5);
+    for (int ind=0; ind<nout; ++ind) {
+        Assert(outframes[ind]);
+        Assert(std::abs(outframes[ind]->time() - ind*readout) < 0.1*tick);
+    }
+
+    // Samples past the last readout are dropped at EOS.
+    const int end = nout*nticks;
+    channel_waves_t got, want;
+    add_frames(outframes, end, got);
+    add_frames(refframes, end, want);
+
+    channel_waves_t all = want;
+    for (const auto& it : got) {
+        all[it.first].resize(end, 0.0);
+    }
+    float peak = 0, maxdiff = 0;
+    double qwant = 0, qgot = 0;
+    for (const auto& it : all) {
+        const auto wit = want.find(it.first);
+        const auto git = got.find(it.first);
+        for (int itick=0; itick<end; ++itick) {
+            const float w = wit == want.end() ? 0.0 : wit->second[itick];
+            const float g = git == got.end() ? 0.0 : git->second[itick];
+            peak = std::max(peak, std::abs(w));
+            maxdiff = std::max(maxdiff, std::abs(w - g));
+            qwant += w;
+            qgot += g;
+        }
+    }
+    cerr << nout << " frames, " << want.size() << " vs " << got.size() << " channels, peak " << peak
+         << ", max difference " << maxdiff << ", total " << qwant << " vs " << qgot << endl;
+    Assert(peak > 0);
+    Assert(maxdiff <= 1e-4*peak);
+    Assert(std::abs(qwant - qgot) <= 1e-4*std::abs(qwant) + 1e-4*peak);
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Check that MultiDuctor in single pass mode gives the same frame as
+// running its sub ductors and merging their frames.  The two sub
+// ductors use responses with different electronics shaping.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellIface/IDuctor.h"
+#include "WireCellIface/SimpleDepo.h"
+
+#include "WireCellUtil/Testing.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 2000;
+const double readout = nticks*tick;
+
+typedef std::map<int, std::vector<float> > channel_waves_t;
+
+void configure_ductor(const std::string& name, const std::string& anode_tn,
+                      const std::vector<std::string>& pir_tns)
+{
+    auto icfg = Factory::lookup<IConfigurable>("Ductor", name);
+    auto cfg = icfg->default_configuration();
+    cfg["anode"] = anode_tn;
+    cfg["tick"] = tick;
+    cfg["start_time"] = 0.0;
+    cfg["readout_time"] = readout;
+    cfg["continuous"] = true;
+    cfg["fluctuate"] = false;
+    cfg["pirs"] = Json::arrayValue;
+    for (const auto& tn : pir_tns) {
+        cfg["pirs"].append(tn);
+    }
+    icfg->configure(cfg);
+}
+
+IDuctor::pointer make_multi(const std::string& name, const std::string& anode_tn,
+                            int maxwire, bool single_pass)
+{
+    auto icfg = Factory::lookup<IConfigurable>("MultiDuctor", name);
+    auto cfg = icfg->default_configuration();
+    cfg["anode"] = anode_tn;
+    cfg["tick"] = tick;
+    cfg["start_time"] = 0.0;
+    cfg["readout_time"] = readout;
+    cfg["continuous"] = true;
+    cfg["single_pass"] = single_pass;
+
+    // Depos over the first collection wires go to one ductor, the
+    // rest to the other.
+    Configuration jrange;
+    jrange["plane"] = 2;
+    jrange["min"] = 0;
+    jrange["max"] = maxwire;
+    Configuration fast, slow;
+    fast["ductor"] = "Ductor:fast";
+    fast["rule"] = "wirebounds";
+    fast["args"][0][0] = jrange;
+    slow["ductor"] = "Ductor:slow";
+    slow["rule"] = "bool";
+    slow["args"] = true;
+    cfg["chains"][0][0] = fast;
+    cfg["chains"][0][1] = slow;
+    icfg->configure(cfg);
+    return Factory::find<IDuctor>("MultiDuctor", name);
+}
+
+channel_waves_t run(IDuctor::pointer ductor, const IDepo::vector& depos)
+{
+    IDuctor::output_queue frames;
+    for (auto depo : depos) {
+        (*ductor)(depo, frames);
+    }
+    (*ductor)(nullptr, frames);
+    Assert(frames.size() == 2);
+    Assert(frames.back() == nullptr);
+
+    channel_waves_t waves;
+    auto frame = frames.front();
+    Assert(frame);
+    Assert(frame->time() == 0.0);
+    for (auto trace : *frame->traces()) {
+        auto& wave = waves[trace->channel()];
+        wave.resize(nticks, 0.0);
+        const auto& charge = trace->charge();
+        for (size_t ind=0; ind<charge.size(); ++ind) {
+            wave.at(trace->tbin() + ind) += charge[ind];
+        }
+    }
+    return waves;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto fast_tns = pir_loader("fast", tick, nticks);
+    {
+        auto icfg = Factory::lookup<IConfigurable>("ElecResponse", "slow");
+        auto cfg = icfg->default_configuration();
+        cfg["tick"] = tick;
+        cfg["shaping"] = 1.0*units::us;
+        icfg->configure(cfg);
+    }
+    Configuration extra;
+    extra["short_responses"][0] = "ElecResponse:slow";
+    auto slow_tns = pir_loader("slow", tick, nticks, extra);
+
+    configure_ductor("fast", anode_tns[0], fast_tns);
+    configure_ductor("slow", anode_tns[0], slow_tns);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tns[0]);
+    auto face = anode->faces()[0];
+    const int nwires = face->planes()[2]->wires().size();
+    const auto bounds = face->sensitive().bounds();
+    const Point lo = bounds.first, hi = bounds.second;
+
+    // Depos along the collection plane, in time order, some near
+    // the ends and some on either side of the split between ductors.
+    IDepo::vector depos;
+    const int ndepos = 20;
+    for (int ind=0; ind<ndepos; ++ind) {
+        const double frac = (ind + 0.5)/ndepos;
+        const Point pos(0.5*(lo.x()+hi.x()), 0.5*(lo.y()+hi.y()), lo.z() + frac*(hi.z()-lo.z()));
+        const double time = 0.2*readout + ind*0.02*readout;
+        depos.push_back(make_shared<SimpleDepo>(time, pos, -5000.0, nullptr,
+                                                1.0*units::mm, 1.0*units::mm));
+    }
+
+    auto classic = run(make_multi("classic", anode_tns[0], nwires/2, false), depos);
+    auto single = run(make_multi("single", anode_tns[0], nwires/2, true), depos);
+
+    // Compare over the channels of either frame.
+    channel_waves_t all = classic;
+    for (const auto& it : single) {
+        all[it.first].resize(nticks, 0.0);
+    }
+    float peak = 0, maxdiff = 0;
+    for (const auto& it : all) {
+        const auto cit = classic.find(it.first);
+        const auto sit = single.find(it.first);
+        for (int itick=0; itick<nticks; ++itick) {
+            const float want = cit == classic.end() ? 0.0 : cit->second[itick];
+            const float got = sit == single.end() ? 0.0 : sit->second[itick];
+            peak = std::max(peak, std::abs(want));
+            maxdiff = std::max(maxdiff, std::abs(want - got));
+        }
+    }
+    cerr << classic.size() << " vs " << single.size() << " channels, peak " << peak
+         << ", max difference " << maxdiff << endl;
+    Assert(peak > 0);
+    Assert(maxdiff < 1e-3*peak);
+    return 0;
+}
@@ -0,0 +1,202 @@
+// Check the plane impact response cache.  Responses are built once
+// into a cache directory and then loaded from it in compact and in
+// full mode.  A truncated and two corrupted cache files must be
+// rejected and rebuilt.  Every response is compared to ones made
+// without a cache.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellGen/PlaneImpactResponse.h"
+
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 2000;
+
+struct file_info_t {
+    ino_t inode;
+    off_t size;
+};
+typedef std::map<std::string, file_info_t> file_infos_t;
+
+// The cache files in the directory, by path.
+file_infos_t cache_files(const std::string& dir)
+{
+    file_infos_t ret;
+    DIR* dp = opendir(dir.c_str());
+    Assert(dp);
+    while (struct dirent* ent = readdir(dp)) {
+        const std::string name = ent->d_name;
+        if (name == "." || name == "..") {
+            continue;
+        }
+        const std::string path = dir + "/" + name;
+        struct stat st;
+        Assert(stat(path.c_str(), &st) == 0);
+        ret[path] = file_info_t{st.st_ino, st.st_size};
+    }
+    closedir(dp);
+    return ret;
+}
+
+template<typename Seq>
+void compare_seq(const Seq& want, const Seq& got)
+{
+    Assert(want.size() == got.size());
+    double peak = 0, maxdiff = 0;
+    for (size_t ind=0; ind<want.size(); ++ind) {
+        peak = std::max(peak, (double)std::abs(want[ind]));
+        maxdiff = std::max(maxdiff, (double)std::abs(want[ind] - got[ind]));
+    }
+    Assert(maxdiff <= 1e-5*peak);
+}
+
+// Compare every impact response of each plane.
+void compare(const std::vector<std::string>& want_tns, const std::vector<std::string>& got_tns,
+             const std::string& what)
+{
+    for (size_t iplane=0; iplane<want_tns.size(); ++iplane) {
+        auto want = Factory::find_tn<IPlaneImpactResponse>(want_tns[iplane]);
+        auto got = Factory::find_tn<IPlaneImpactResponse>(got_tns[iplane]);
+        Assert(want->impact() == got->impact());
+        Assert(want->pitch_range() == got->pitch_range());
+        Assert(want->nwires() == got->nwires());
+        auto wgpir = std::dynamic_pointer_cast<Gen::PlaneImpactResponse>(want);
+        auto ggpir = std::dynamic_pointer_cast<Gen::PlaneImpactResponse>(got);
+        Assert(wgpir && ggpir);
+        Assert(wgpir->field_pad() == ggpir->field_pad());
+        compare_seq(wgpir->short_waveform(), ggpir->short_waveform());
+
+        int count = 0;
+        const double half = 0.5*want->pitch_range();
+        for (double relpitch = -half; relpitch <= half; relpitch += want->impact()) {
+            auto wir = want->closest(relpitch);
+            auto gir = got->closest(relpitch);
+            Assert(wir && gir);
+            Assert(wir->impact() == gir->impact());
+            compare_seq(wir->spectrum(), gir->spectrum());
+            compare_seq(wir->waveform(), gir->waveform());
+            compare_seq(wir->long_aux_waveform(), gir->long_aux_waveform());
+
+            auto wgir = std::dynamic_pointer_cast<Gen::ImpactResponse>(wir);
+            auto ggir = std::dynamic_pointer_cast<Gen::ImpactResponse>(gir);
+            Assert(wgir && ggir);
+            compare_seq(wgir->field_waveform(), ggir->field_waveform());
+            ++count;
+        }
+        cerr << what << ": plane " << iplane << ", " << count << " responses match" << endl;
+        Assert(count > 0);
+    }
+}
+
+// Overwrite bytes of a file in place.
+void overwrite(const std::string& path, off_t offset, const void* data, size_t size)
+{
+    std::fstream out(path, std::ios::in | std::ios::out | std::ios::binary);
+    Assert(out);
+    out.seekp(offset);
+    out.write((const char*)data, size);
+    Assert(out);
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto ref_tns = pir_loader("ref", tick, nticks);
+
+    char dirtmpl[] = "/tmp/test_pir_cache_XXXXXX";
+    Assert(mkdtemp(dirtmpl));
+    const std::string cache_dir = dirtmpl;
+
+    Configuration extra;
+    extra["cache_dir"] = cache_dir;
+
+    // A file is written for each plane.
+    auto built_tns = pir_loader("built", tick, nticks, extra);
+    compare(ref_tns, built_tns, "built");
+    const auto built = cache_files(cache_dir);
+    Assert(built.size() == ref_tns.size());
+
+    // Loading leaves the files as they are.  The file is shared by
+    // both modes.
+    for (bool compact : {true, false}) {
+        extra["compact"] = compact;
+        const std::string name = compact ? "loadcompact" : "loadfull";
+        auto tns = pir_loader(name, tick, nticks, extra);
+        compare(ref_tns, tns, name);
+        const auto loaded = cache_files(cache_dir);
+        Assert(loaded.size() == built.size());
+        for (const auto& it : built) {
+            Assert(loaded.at(it.first).inode == it.second.inode);
+        }
+    }
+
+    // Spoil each file in place: truncate one, break the magic of
+    // another and give the last an impossible wire count, which
+    // follows the magic, key, three doubles and an int.
+    int ispoil = 0;
+    for (const auto& it : built) {
+        const std::string& path = it.first;
+        if (ispoil == 0) {
+            Assert(truncate(path.c_str(), it.second.size/2) == 0);
+        }
+        else if (ispoil == 1) {
+            const char bad[] = "XXXX";
+            overwrite(path, 0, bad, 4);
+        }
+        else {
+            const uint64_t nwires = 1ULL<<40;
+            overwrite(path, 8+8+3*8+4, &nwires, sizeof(nwires));
+        }
+        ++ispoil;
+    }
+
+    // Each spoiled file is rejected and replaced, here by a compact
+    // response.
+    extra["compact"] = true;
+    auto rebuilt_tns = pir_loader("rebuilt", tick, nticks, extra);
+    compare(ref_tns, rebuilt_tns, "rebuilt");
+    const auto rebuilt = cache_files(cache_dir);
+    Assert(rebuilt.size() == built.size());
+    for (const auto& it : built) {
+        const auto& info = rebuilt.at(it.first);
+        Assert(info.inode != it.second.inode);
+        Assert(info.size == it.second.size);
+    }
+
+    // And the replacements load in full mode.
+    extra["compact"] = false;
+    auto reloaded_tns = pir_loader("reloaded", tick, nticks, extra);
+    compare(ref_tns, reloaded_tns, "reloaded");
+    const auto reloaded = cache_files(cache_dir);
+    Assert(reloaded.size() == built.size());
+    for (const auto& it : rebuilt) {
+        Assert(reloaded.at(it.first).inode == it.second.inode);
+    }
+
+    for (const auto& it : reloaded) {
+        std::remove(it.first.c_str());
+    }
+    rmdir(cache_dir.c_str());
+    return 0;
+}
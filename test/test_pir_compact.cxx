@@ -0,0 +1,116 @@
+// Check that plane impact responses give the same spectra, waveforms
+// and simulated signal whether or not they are kept compact.
+
+#include "anode_loader.h"
+#include "pir_loader.h"
+
+#include "WireCellGen/BinnedDiffusion.h"
+#include "WireCellGen/ImpactZipper.h"
+
+#include "WireCellIface/IPlaneImpactResponse.h"
+#include "WireCellIface/SimpleDepo.h"
+
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <cmath>
+#include <iostream>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nticks = 4000;
+
+std::vector<Waveform::realseq_t> plane_waves(IPlaneImpactResponse::pointer pir, const Pimpos& pimpos,
+                                             const Binning& tbins, const IDepo::vector& depos)
+{
+    Gen::BinnedDiffusion bd(pimpos, tbins, 3.0, nullptr);
+    for (auto depo : depos) {
+        bd.add(depo, 1.0*units::us, 1.0*units::mm);
+    }
+    Gen::ImpactZipper zipper(pir, bd);
+    std::vector<Waveform::realseq_t> waves;
+    const int nwires = pimpos.region_binning().nbins();
+    for (int iwire=0; iwire<nwires; ++iwire) {
+        waves.push_back(zipper.waveform(iwire));
+    }
+    return waves;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string detector = "uboone";
+    if (argc > 1) {
+        detector = argv[1];
+    }
+    auto anode_tns = anode_loader(detector);
+    auto full_tns = pir_loader("full", tick, nticks);
+    Configuration extra;
+    extra["compact"] = true;
+    auto compact_tns = pir_loader("compact", tick, nticks, extra);
+
+    auto anode = Factory::find_tn<IAnodePlane>(anode_tns[0]);
+    auto face = anode->faces()[0];
+    Binning tbins(nticks, 0, nticks*tick);
+
+    int iplane = -1;
+    for (auto plane : face->planes()) {
+        ++iplane;
+        auto full = Factory::find_tn<IPlaneImpactResponse>(full_tns[iplane]);
+        auto compact = Factory::find_tn<IPlaneImpactResponse>(compact_tns[iplane]);
+
+        // Every impact response, compared bin by bin.
+        const double half = 0.5*full->pitch_range();
+        for (double relpitch = -half; relpitch <= half; relpitch += full->impact()) {
+            auto fir = full->closest(relpitch);
+            auto cir = compact->closest(relpitch);
+            Assert(fir && cir);
+            Assert(fir->impact() == cir->impact());
+
+            const auto& fspec = fir->spectrum();
+            const auto& cspec = cir->spectrum();
+            Assert(fspec.size() == cspec.size());
+            double speak = 0, sdiff = 0;
+            for (size_t ind=0; ind<fspec.size(); ++ind) {
+                speak = std::max(speak, (double)std::abs(fspec[ind]));
+                sdiff = std::max(sdiff, (double)std::abs(fspec[ind] - cspec[ind]));
+            }
+            Assert(sdiff <= 1e-5*speak);
+
+            const auto& fwave = fir->waveform();
+            const auto& cwave = cir->waveform();
+            Assert(fwave.size() == cwave.size());
+            double wpeak = 0, wdiff = 0;
+            for (size_t ind=0; ind<fwave.size(); ++ind) {
+                wpeak = std::max(wpeak, (double)std::abs(fwave[ind]));
+                wdiff = std::max(wdiff, (double)std::abs(fwave[ind] - cwave[ind]));
+            }
+            Assert(wdiff <= 1e-5*wpeak);
+        }
+
+        const Pimpos* pimpos = plane->pimpos();
+        const auto rb = pimpos->region_binning();
+        IDepo::vector depos;
+        for (int iwire : {rb.nbins()/4, rb.nbins()/2}) {
+            const double pitch = rb.center(iwire) + 0.3*rb.binsize();
+            const Point pos = pimpos->origin() + pimpos->axis(2)*pitch;
+            depos.push_back(make_shared<SimpleDepo>(0.5*units::ms + iwire*tick, pos, -5000.0));
+        }
+        auto fwaves = plane_waves(full, *pimpos, tbins, depos);
+        auto cwaves = plane_waves(compact, *pimpos, tbins, depos);
+        Assert(fwaves.size() == cwaves.size());
+        float peak = 0, maxdiff = 0;
+        for (size_t iwire=0; iwire<fwaves.size(); ++iwire) {
+            Assert(fwaves[iwire].size() == cwaves[iwire].size());
+            for (size_t itick=0; itick<fwaves[iwire].size(); ++itick) {
+                peak = std::max(peak, std::abs(fwaves[iwire][itick]));
+                maxdiff = std::max(maxdiff, std::abs(fwaves[iwire][itick] - cwaves[iwire][itick]));
+            }
+        }
+        cerr << "plane " << iplane << ": peak " << peak << ", max difference " << maxdiff << endl;
+        Assert(peak > 0);
+        Assert(maxdiff <= 1e-5*peak);
+    }
+    return 0;
+}
@@ -0,0 +1,169 @@
+// Check that Misconfigure and PerChannelVariation, which convolve
+// traces of equal length in batches, give the same traces as
+// Waveform::replace_convolve() applied to each trace.  Traces of
+// several lengths are used, with and without truncation and, for
+// PerChannelVariation, with and without its cached spectra.
+
+#include "WireCellIface/IChannelResponse.h"
+#include "WireCellIface/IConfigurable.h"
+#include "WireCellIface/IFrameFilter.h"
+#include "WireCellIface/SimpleFrame.h"
+#include "WireCellIface/SimpleTrace.h"
+
+#include "WireCellUtil/NamedFactory.h"
+#include "WireCellUtil/PluginManager.h"
+#include "WireCellUtil/Response.h"
+#include "WireCellUtil/Testing.h"
+#include "WireCellUtil/Units.h"
+#include "WireCellUtil/Waveform.h"
+
+#include <cmath>
+#include <iostream>
+#include <map>
+
+using namespace WireCell;
+using namespace std;
+
+const double tick = 0.5*units::us;
+const int nresp = 300;
+const int nchannels = 8;
+
+// Per channel responses with a gain and shaping varying by channel.
+class TestChannelResponse : public IChannelResponse {
+    std::map<int, Waveform::realseq_t> m_resps;
+public:
+    TestChannelResponse() {
+        Binning bins(nresp, 0, nresp*tick);
+        for (int ch=0; ch<nchannels; ++ch) {
+            m_resps[ch] = Response::ColdElec((10.0 + ch)*units::mV/units::fC,
+                                             (1.0 + 0.2*ch)*units::us).generate(bins);
+        }
+    }
+    virtual ~TestChannelResponse() {}
+    virtual const Waveform::realseq_t& channel_response(int chid) const {
+        return m_resps.at(chid);
+    }
+    virtual Binning channel_response_binning() const {
+        return Binning(nresp, 0, nresp*tick);
+    }
+};
+WIRECELL_FACTORY(TestChannelResponse, TestChannelResponse, WireCell::IChannelResponse)
+
+// Traces of mixed lengths, some sharing a length, on each channel.
+IFrame::pointer make_frame()
+{
+    ITrace::vector traces;
+    int count = 0;
+    for (int nsamples : {10, 100, 37, 100, 500, 1000, 37, 2000}) {
+        const int ch = count % nchannels;
+        Waveform::realseq_t charge(nsamples);
+        for (int ind=0; ind<nsamples; ++ind) {
+            charge[ind] = 100.0*std::sin(0.05*(ind + 13*count)) + ((ind*7+count)%31 == 0 ? 500.0 : 0.0);
+        }
+        traces.push_back(make_shared<SimpleTrace>(ch, 10*count, charge));
+        ++count;
+    }
+    return make_shared<SimpleFrame>(0, 0.0, traces, tick);
+}
+
+// Compare the frame's traces to the expected waveforms.
+void compare(IFrame::pointer in, IFrame::pointer out, const std::vector<Waveform::realseq_t>& want,
+             const std::string& what)
+{
+    Assert(out);
+    auto intraces = in->traces();
+    auto outtraces = out->traces();
+    Assert(outtraces->size() == want.size());
+    float peak = 0, maxdiff = 0;
+    for (size_t ind=0; ind<want.size(); ++ind) {
+        auto trace = outtraces->at(ind);
+        Assert(trace->channel() == intraces->at(ind)->channel());
+        Assert(trace->tbin() == intraces->at(ind)->tbin());
+        const auto& got = trace->charge();
+        Assert(got.size() == want[ind].size());
+        for (size_t isamp=0; isamp<got.size(); ++isamp) {
+            peak = std::max(peak, std::abs(want[ind][isamp]));
+            maxdiff = std::max(maxdiff, std::abs(want[ind][isamp] - got[isamp]));
+        }
+    }
+    cerr << what << ": peak " << peak << ", max difference " << maxdiff << endl;
+    Assert(peak > 0);
+    Assert(maxdiff < 1e-4*peak);
+}
+
+void test_misconfigure(IFrame::pointer frame, bool truncate)
+{
+    const std::string name = truncate ? "truncate" : "full";
+    auto icfg = Factory::lookup<IConfigurable>("Misconfigure", name);
+    auto cfg = icfg->default_configuration();
+    cfg["truncate"] = truncate;
+    icfg->configure(cfg);
+    auto filter = Factory::find<IFrameFilter>("Misconfigure", name);
+
+    const int n = cfg["nsamples"].asInt();
+    Binning bins(n, 0, n*cfg["tick"].asDouble());
+    auto from = Response::ColdElec(cfg["from"]["gain"].asDouble(),
+                                   cfg["from"]["shaping"].asDouble()).generate(bins);
+    auto to = Response::ColdElec(cfg["to"]["gain"].asDouble(),
+                                 cfg["to"]["shaping"].asDouble()).generate(bins);
+    std::vector<Waveform::realseq_t> want;
+    for (auto trace : *frame->traces()) {
+        want.push_back(Waveform::replace_convolve(trace->charge(), to, from, truncate));
+    }
+
+    // Twice, the second time with the ratio spectra cached.
+    for (int pass=0; pass<2; ++pass) {
+        IFrame::pointer out;
+        Assert((*filter)(frame, out));
+        compare(frame, out, want, "Misconfigure " + name);
+    }
+}
+
+void test_perchannelvariation(IFrame::pointer frame, bool truncate, bool cache_spectra)
+{
+    const std::string name = std::string(truncate ? "truncate" : "full") + (cache_spectra ? "cached" : "batched");
+    auto icfg = Factory::lookup<IConfigurable>("PerChannelVariation", name);
+    auto cfg = icfg->default_configuration();
+    cfg["tick"] = tick;
+    cfg["truncate"] = truncate;
+    cfg["cache_spectra"] = cache_spectra;
+    cfg["per_chan_resp"] = "TestChannelResponse";
+    icfg->configure(cfg);
+    auto filter = Factory::find<IFrameFilter>("PerChannelVariation", name);
+
+    auto cr = Factory::find_tn<IChannelResponse>("TestChannelResponse");
+    auto from = Response::ColdElec(cfg["gain"].asDouble(),
+                                   cfg["shaping"].asDouble()).generate(cr->channel_response_binning());
+    std::vector<Waveform::realseq_t> want;
+    for (auto trace : *frame->traces()) {
+        Waveform::realseq_t resp = cr->channel_response(trace->channel());
+        resp.resize(nresp, 0);
+        want.push_back(Waveform::replace_convolve(trace->charge(), resp, from, truncate));
+    }
+
+    // Twice, the second time with the responses and spectra cached.
+    for (int pass=0; pass<2; ++pass) {
+        IFrame::pointer out;
+        Assert((*filter)(frame, out));
+        compare(frame, out, want, "PerChannelVariation " + name);
+    }
+}
+
+int main()
+{
+    PluginManager& pm = PluginManager::instance();
+    pm.add("WireCellGen");
+
+    // This component is not in a plugin library so register it
+    // directly with the factory function WIRECELL_FACTORY defines.
+    make_TestChannelResponse_factory();
+
+    auto frame = make_frame();
+    for (bool truncate : {true, false}) {
+        test_misconfigure(frame, truncate);
+        for (bool cache_spectra : {false, true}) {
+            test_perchannelvariation(frame, truncate, cache_spectra);
+        }
+    }
+    return 0;
+}